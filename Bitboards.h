@@ -41,12 +41,84 @@ inline uint8_t getLeastSquare(uint64_t board)
    return _mm_tzcnt_64(board);
 }
 
+// mirror the bitboard top to bottom. each rank is one byte, so this just reverses the bytes
+inline uint64_t flipVertical(uint64_t board)
+{
+    return __builtin_bswap64(board);
+}
+
 // get a bitboard with one set bit, by bit index
 inline uint64_t boardOf(uint8_t square)
 {
     return (uint64_t)(1) << square;
 }
 
+// a bitboard for every pair of squares. index it like a 64x64 array
+struct SquarePairTable
+{
+    uint64_t squares[64][64];
+
+    constexpr const uint64_t *operator[](int square) const
+    {
+        return squares[square];
+    }
+};
+
+/*
+ * walk out from every square in all 8 directions. if isLine, every square we pass gets the whole line through both
+ * squares, from edge to edge. otherwise it gets the squares we walked over to get there, not counting either end.
+ * pairs of squares that are not on the same rank, file or diagonal get nothing
+ */
+constexpr SquarePairTable getSquarePairTable(bool isLine)
+{
+    SquarePairTable table{};
+    const int directions[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+    for (int from = 0; from < 64; from++)
+    {
+        for (int direction = 0; direction < 8; direction++)
+        {
+            int fileStep = directions[direction][0];
+            int rankStep = directions[direction][1];
+
+            // the line goes both ways from the square
+            uint64_t line = (uint64_t)(1) << from;
+            for (int sign = -1; sign <= 1; sign += 2)
+            {
+                int file = from % 8 + fileStep * sign;
+                int rank = from / 8 + rankStep * sign;
+                while (file >= 0 && file < 8 && rank >= 0 && rank < 8)
+                {
+                    line |= (uint64_t)(1) << (rank * 8 + file);
+                    file += fileStep * sign;
+                    rank += rankStep * sign;
+                }
+            }
+
+            uint64_t between = 0;
+            int file = from % 8 + fileStep;
+            int rank = from / 8 + rankStep;
+            while (file >= 0 && file < 8 && rank >= 0 && rank < 8)
+            {
+                int to = rank * 8 + file;
+                table.squares[from][to] = isLine ? line : between;
+                between |= (uint64_t)(1) << to;
+                file += fileStep;
+                rank += rankStep;
+            }
+        }
+    }
+    return table;
+}
+
+/*
+ * BETWEEN[a][b] is the squares strictly between two squares, and LINE[a][b] is the whole line through them.
+ * a check can be blocked on BETWEEN[king][checker], a piece pinned by a slider can only move along
+ * BETWEEN[king][slider], and a piece stays in the way of a line as long as it moves onto LINE[king][from].
+ * the compiler makes these, so they cost nothing when the program starts
+ */
+constexpr SquarePairTable BETWEEN = getSquarePairTable(false);
+constexpr SquarePairTable LINE = getSquarePairTable(true);
+
 // generate a random 64 bit number by iterating over each bit
 // and setting it to be either 0 or 1. kind of slow, but used
 // only for generating sliding attack magic numbers on startup
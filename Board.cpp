@@ -2,7 +2,9 @@
 // Created by Joe Chrisman on 2/23/22.
 //
 
+#include <sstream>
 #include "Board.h"
+#include "MoveGen.h"
 
 Board::Board()
 {
@@ -26,6 +28,12 @@ Board::Board()
     }
     update();
     engineToMove = ENGINE_IS_WHITE;
+    attackTracker = nullptr;
+}
+
+void Board::trackChanges(uint64_t changed)
+{
+    attackTracker->refreshAttacks(changed);
 }
 
 std::string Board::getMoveNotation(Move &move)
@@ -78,3 +86,146 @@ std::string Board::getMoveNotation(Move &move)
     return notation;
 }
 
+
+bool Board::loadFen(const std::string &fen)
+{
+    std::istringstream stream(fen);
+    std::string placement, sideToMove, castling, enPassant;
+    if (!(stream >> placement >> sideToMove >> castling >> enPassant))
+    {
+        return false;
+    }
+    if (sideToMove != "w" && sideToMove != "b")
+    {
+        return false;
+    }
+
+    // the square of a file (0 is the a file) and a rank (0 is the first rank), as seen from the engine's side of the board
+    auto getSquare = [](int file, int rank)
+    {
+        return ENGINE_IS_WHITE ? rank * 8 + 7 - file : (7 - rank) * 8 + file;
+    };
+
+    Position loaded = Position{
+            {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+            false,
+            false,
+            false,
+            false,
+            0
+    };
+
+    // the placement starts on the eighth rank, at the a file
+    int rank = 7;
+    int file = 0;
+    for (char character : placement)
+    {
+        if (character == '/')
+        {
+            if (file != 8 || --rank < 0)
+            {
+                return false;
+            }
+            file = 0;
+        }
+        else if (character >= '1' && character <= '8')
+        {
+            file += character - '0';
+        }
+        else
+        {
+            size_t index = std::string("pnbrqk").find((char)tolower(character));
+            if (index == std::string::npos || file > 7)
+            {
+                return false;
+            }
+            bool isWhite = isupper(character);
+            int pieceType = (isWhite == ENGINE_IS_WHITE ? ENGINE_PAWN : PLAYER_PAWN) + (int)index;
+            loaded.pieces[pieceType] |= boardOf(getSquare(file, rank));
+            file++;
+        }
+        if (file > 8)
+        {
+            return false;
+        }
+    }
+    if (rank != 0 || file != 8)
+    {
+        return false;
+    }
+
+    // both sides need exactly one king, or there is nothing to check and nothing to mate
+    if (countSetBits(loaded.pieces[ENGINE_KING]) != 1 || countSetBits(loaded.pieces[PLAYER_KING]) != 1)
+    {
+        return false;
+    }
+
+    // a right is only kept while the king and that rook are still on their starting squares.
+    // otherwise the move generator would castle a king or a rook that isn't there
+    auto canCastle = [&](char right, bool isWhite, int rookFile)
+    {
+        int homeRank = isWhite ? 0 : 7;
+        bool isEngine = isWhite == ENGINE_IS_WHITE;
+        return castling.find(right) != std::string::npos &&
+               loaded.pieces[isEngine ? ENGINE_KING : PLAYER_KING] & boardOf(getSquare(4, homeRank)) &&
+               loaded.pieces[isEngine ? ENGINE_ROOK : PLAYER_ROOK] & boardOf(getSquare(rookFile, homeRank));
+    };
+    bool whiteKingside = canCastle('K', true, 7);
+    bool whiteQueenside = canCastle('Q', true, 0);
+    bool blackKingside = canCastle('k', false, 7);
+    bool blackQueenside = canCastle('q', false, 0);
+    loaded.engineCastleKingside = ENGINE_IS_WHITE ? whiteKingside : blackKingside;
+    loaded.engineCastleQueenside = ENGINE_IS_WHITE ? whiteQueenside : blackQueenside;
+    loaded.playerCastleKingside = ENGINE_IS_WHITE ? blackKingside : whiteKingside;
+    loaded.playerCastleQueenside = ENGINE_IS_WHITE ? blackQueenside : whiteQueenside;
+
+    bool isEngine = (sideToMove == "w") == ENGINE_IS_WHITE;
+    // FEN gives the square behind the pawn that just moved two squares, but we remember the pawn itself.
+    // like makeMove(), only remember it if there is an enemy pawn next to it that could capture it
+    if (enPassant.size() == 2 && enPassant[0] >= 'a' && enPassant[0] <= 'h' && (enPassant[1] == '3' || enPassant[1] == '6'))
+    {
+        int pawnFile = enPassant[0] - 'a';
+        int pawnRank = enPassant[1] == '6' ? 4 : 3;
+        uint64_t capturers = loaded.pieces[isEngine ? ENGINE_PAWN : PLAYER_PAWN];
+        bool canCapture = (pawnFile > 0 && capturers & boardOf(getSquare(pawnFile - 1, pawnRank))) ||
+                          (pawnFile < 7 && capturers & boardOf(getSquare(pawnFile + 1, pawnRank)));
+        if (canCapture)
+        {
+            loaded.enPassantCapture = boardOf(getSquare(pawnFile, pawnRank));
+        }
+    }
+
+    // the side that just moved can't be in check, because then the side to move would take its king.
+    // look for a piece of the side to move that sees the other king
+    uint64_t occupied = 0;
+    for (uint64_t pieces : loaded.pieces)
+    {
+        occupied |= pieces;
+    }
+    uint8_t king = getLeastSquare(loaded.pieces[isEngine ? PLAYER_KING : ENGINE_KING]);
+    uint64_t *attackers = loaded.pieces + (isEngine ? ENGINE_PAWN : PLAYER_PAWN);
+    // engine pawns move down the board and player pawns move up it
+    uint64_t pawns = attackers[0];
+    uint64_t pawnAttacks = isEngine ? (pawns & ~FILE7) << 9 | (pawns & ~FILE0) << 7
+                                    : (pawns & ~FILE7) >> 7 | (pawns & ~FILE0) >> 9;
+    bool isChecked = pawnAttacks & boardOf(king) || KNIGHT_MOVES[king] & attackers[1] || KING_MOVES[king] & attackers[5];
+    uint64_t sliders = attackers[2] | attackers[3] | attackers[4];
+    while (sliders && !isChecked)
+    {
+        uint8_t slider = popLeastSquare(sliders);
+        bool isCardinal = slider / 8 == king / 8 || slider % 8 == king % 8;
+        bool isOrdinal = abs(slider / 8 - king / 8) == abs(slider % 8 - king % 8);
+        bool canSlide = isCardinal ? boardOf(slider) & (attackers[3] | attackers[4])
+                                   : isOrdinal && boardOf(slider) & (attackers[2] | attackers[4]);
+        isChecked = canSlide && !(BETWEEN[slider][king] & occupied);
+    }
+    if (isChecked)
+    {
+        return false;
+    }
+
+    position = loaded;
+    engineToMove = isEngine;
+    update();
+    return true;
+}
@@ -7,6 +7,8 @@
 
 #include "Bitboards.h"
 
+class MoveGen;
+
 class Board
 {
 
@@ -63,11 +65,24 @@ public:
     uint64_t emptySquares;
     uint64_t occupiedSquares;
 
+    /*
+     * who attacks what. attacksFrom[square] is every square the piece on that square attacks,
+     * and attacksTo[square] is every piece (of either side) that attacks that square.
+     * these are only kept up to date while a move generator tracks this board (see MoveGen::trackAttacks()).
+     * then makeMove() and restore() only work out the attacks again for the pieces on the squares that changed,
+     * and the sliders that looked through those squares
+     */
+    uint64_t attacksFrom[64];
+    uint64_t attacksTo[64];
+    // the move generator tracking the attacks, or null if nobody is
+    MoveGen *attackTracker;
+
     template <bool isEngine>
     inline void makeMove(Move &move)
     {
         uint64_t enPassant = position.enPassantCapture;
         position.enPassantCapture = 0;
+        uint64_t occupiedBefore = occupiedSquares;
 
         uint64_t &moving = position.pieces[move.moving];
 
@@ -205,8 +220,41 @@ public:
         // update some extra bitboards
         update();
         engineToMove = !engineToMove;
+
+        if (attackTracker)
+        {
+            // a capture or a promotion changes the piece on the destination square without changing the occupancy
+            trackChanges((occupiedBefore ^ occupiedSquares) | squareTo);
+        }
+    }
+
+    /*
+     * unmake a move by putting back the position from before it was made.
+     * if the attacks are tracked, the extra bitboards are updated too, because the attack tables need them
+     */
+    inline void restore(Position &clone)
+    {
+        if (attackTracker)
+        {
+            uint64_t changed = 0;
+            for (int pieceType = PLAYER_PAWN; pieceType < NONE; pieceType++)
+            {
+                changed |= position.pieces[pieceType] ^ clone.pieces[pieceType];
+            }
+            position = clone;
+            update();
+            trackChanges(changed);
+        }
+        else
+        {
+            position = clone;
+        }
+        engineToMove = !engineToMove;
     }
 
+    // give the changed squares to the attack tracker
+    void trackChanges(uint64_t changed);
+
     /*
      * this might be bugged. make sure it gives the correct perft results before use
      *
@@ -284,6 +332,26 @@ public:
         engineToMove = !engineToMove;
     }*/
 
+    /*
+     * mirror the board top to bottom and swap the engine's pieces with the player's, castling rights included.
+     * the player's pieces end up where the engine's pieces would be, so code written for the engine's side of
+     * the board works for the player too. flipping twice gives back the same position.
+     * this does not update the attack tables, so don't flip a board that is being tracked
+     */
+    inline void flip()
+    {
+        for (int pieceType = PLAYER_PAWN; pieceType < ENGINE_PAWN; pieceType++)
+        {
+            uint64_t playerPiece = position.pieces[pieceType];
+            position.pieces[pieceType] = flipVertical(position.pieces[pieceType + ENGINE_PAWN]);
+            position.pieces[pieceType + ENGINE_PAWN] = flipVertical(playerPiece);
+        }
+        std::swap(position.playerCastleKingside, position.engineCastleKingside);
+        std::swap(position.playerCastleQueenside, position.engineCastleQueenside);
+        position.enPassantCapture = flipVertical(position.enPassantCapture);
+        update();
+    }
+
     inline void update()
     {
         enginePieces = position.pieces[ENGINE_PAWN] | position.pieces[ENGINE_KNIGHT] |
@@ -365,6 +433,14 @@ public:
 
     std::string getMoveNotation(Move &move);
 
+    /*
+     * set up the position from a FEN string. EPD lines work too, because only the first four fields are read.
+     * the move counters are ignored. returns false and leaves the board alone if the string doesn't make sense,
+     * if a side doesn't have exactly one king, or if the side that just moved is in check.
+     * castling rights are dropped when the king or that rook is not on its starting square
+     */
+    bool loadFen(const std::string &fen);
+
 };
 
 
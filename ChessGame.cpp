@@ -4,7 +4,7 @@
 
 #include "ChessGame.h"
 
-ChessGame::ChessGame(SDL_Renderer *renderer)
+ChessGame::ChessGame(SDL_Renderer *renderer, const std::string &sharedTable, SearchLog *searchLog)
 {
     this->renderer = renderer;
 
@@ -76,6 +76,41 @@ ChessGame::ChessGame(SDL_Renderer *renderer)
     generator = new MoveGen(board);
     search = new Search(generator);
 
+    // use the settings "--autotune" picked for this machine, if it was ever run
+    EngineConfig config;
+    if (config.load(ENGINE_CONFIG_FILE))
+    {
+        config.apply(search);
+    }
+    if (searchLog)
+    {
+        search->log = searchLog->addSearcher();
+    }
+
+    // order quiet moves with the learned table, if somebody made one
+    prior = new MovePrior();
+    if (prior->load(MOVE_PRIOR_FILE))
+    {
+        generator->prior = prior;
+    }
+
+    // score positions with the trained network, if somebody trained one
+    Network *network = new Network();
+    if (network->load(NETWORK_FILE))
+    {
+        search->evaluator.network = network;
+    }
+    else
+    {
+        delete network;
+    }
+    // share what the engine learns with the other engines on this machine. without it, the engine has its own table.
+    // the scores in the table come from the evaluation, so this waits until we know which one we use
+    if (!sharedTable.empty())
+    {
+        search->table.share(sharedTable, search->evaluator.network);
+    }
+
     if (ENGINE_IS_WHITE)
     {
         makeEngineMove();
@@ -355,6 +390,12 @@ void ChessGame::onMouseMoved(int mouseX, int mouseY)
 
 void ChessGame::onMousePressed(int mouseX, int mouseY, bool isRightClick)
 {
+    // the board is in the middle of the game tree while the engine is thinking. so don't touch it
+    if (search->isSearching())
+    {
+        return;
+    }
+
     // if we clicked while making a promotion choice
     if (promotionSquare && !board->engineToMove)
     {
@@ -442,7 +483,7 @@ void ChessGame::onMousePressed(int mouseX, int mouseY, bool isRightClick)
                     resetMoveOptions();
                     for (Board::Move &move : generator->getSortedMoves())
                     {
-                        if (move.from == clicked->squareIndex)
+                        if (move.from == clicked->squareIndex && generator->isLegalMove(move))
                         {
                             boardGui[move.to].isCurrentMove = true;
                         }
@@ -584,11 +625,32 @@ void ChessGame::resetMoveHighlights()
 
 void ChessGame::makeEngineMove()
 {
+    // if we don't want to freeze the window, start searching now and play the move in updateSearch() later
+    if (TIME_SLICED_SEARCH)
+    {
+        search->startSearch();
+        return;
+    }
     Board::Move best = search->getBestMove();
     setMovingPiece(&boardGui[best.from], &boardGui[best.to]);
     board->makeMove<true>(best);
 }
 
+void ChessGame::updateSearch()
+{
+    // if the engine is thinking, let it think for a little while
+    if (search->isSearching())
+    {
+        // if the engine finished thinking
+        if (search->continueSearch(SEARCH_SLICE_MS))
+        {
+            Board::Move best = search->getSearchResult();
+            setMovingPiece(&boardGui[best.from], &boardGui[best.to]);
+            board->makeMove<true>(best);
+        }
+    }
+}
+
 /*
  * we need a way to check if the engine or the player is moving a piece
  * this does not include dragging
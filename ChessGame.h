@@ -5,7 +5,7 @@
 #ifndef UNTITLED2_CHESSGAME_H
 #define UNTITLED2_CHESSGAME_H
 
-#include "Search.h"
+#include "EngineConfig.h"
 
 /*
  * this class handles things required to get the game running up on the screen.
@@ -22,7 +22,11 @@ class ChessGame
 {
 public:
 
-    ChessGame(SDL_Renderer *renderer);
+    /*
+     * the engine keeps its main transposition table in the shared memory segment with this name, unless it is empty.
+     * if searchLog is not null, every engine search is recorded in it
+     */
+    ChessGame(SDL_Renderer *renderer, const std::string &sharedTable, SearchLog *searchLog);
     SDL_Renderer *renderer;
 
     /*
@@ -44,6 +48,8 @@ public:
 
     // move the moving piece little by little towards its destination
     void updateMovingPiece();
+    // give the time sliced search a little time to think, and play its move once it is done
+    void updateSearch();
     // render the board gui
     void render();
     bool isAnimating();
@@ -73,6 +79,9 @@ private:
      */
     Search *search;
 
+    // the learned quiet move ordering table, loaded from MOVE_PRIOR_FILE
+    MovePrior *prior;
+
     /*
      * a Piece struct purely used for dragging and rendering pieces. basically a "sprite" struct
      *
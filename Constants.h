@@ -51,6 +51,127 @@ const bool ENGINE_IS_WHITE = true;
 const int WINDOW_SIZE = SQUARE_SIZE * 8;
 const int SEARCH_DEPTH = 5;
 
+// when this is true, the engine searches a little bit every frame instead of freezing the window until it finds a move.
+// this is for builds that can't use threads. the move the engine finds is the same either way
+const bool TIME_SLICED_SEARCH = true;
+// how many milliseconds of each frame the time sliced search is allowed to use
+const int SEARCH_SLICE_MS = 1000 / FRAMERATE / 2;
+// the longest we want anybody to wait for the engine's move. "--latency-bench" counts the moves that take longer
+const int MOVE_DEADLINE_MS = 2000;
+// how many searches "--schedule" keeps going at the same time, and how long it lets one of them search before picking again
+const int SCHEDULER_ENGINES = 4;
+const int SCHEDULER_SLICE_MS = 10;
+// the bounds of the move latency histogram that "--metrics" serves, in milliseconds
+const int METRICS_LATENCY_BUCKET_COUNT = 9;
+const int METRICS_LATENCY_BUCKETS_MS[METRICS_LATENCY_BUCKET_COUNT] = {10, 50, 100, 250, 500, 1000, 2000, 5000, 10000};
+// how long the metrics server waits for a client to send its request or take the response before hanging up on it
+const int METRICS_CLIENT_TIMEOUT_MS = 1000;
+// random playouts that are still going after this many plies are called a draw. the fifty move rule ends most of them first
+const int PLAYOUT_MAX_PLIES = 1000;
+// how many times more likely a playout is to pick a capture than a quiet move. 1 picks every legal move the same
+const int PLAYOUT_CAPTURE_WEIGHT = 1;
+// change this whenever SearchLog::Record changes, so "--replay" doesn't read an old log the wrong way
+const uint32_t SEARCH_LOG_VERSION = 1;
+
+// when this is true, the move generator ignores pins. moves that leave our king in check are thrown out
+// right before they are searched instead, so we don't spend time on pins at nodes that cut off early.
+// this is only the default, ENGINE_CONFIG_FILE can change it
+const bool PSEUDO_LEGAL_GENERATION = false;
+
+// generate the player's moves by flipping the board and running the engine's move generator, so only the engine's side
+// of the generator is used while searching. the moves come out in a different order, so the search tree changes a little.
+// on this machine it is as fast as the normal generator. this is only the default, ENGINE_CONFIG_FILE can change it
+const bool FLIPPED_GENERATION = false;
+
+// look for a mate in one without searching one ply above the leaves, instead of searching every move there.
+// this is only the default, ENGINE_CONFIG_FILE can change it
+const bool MATE_IN_ONE_DETECTION = true;
+// also look for a mate in one in the quiescence search. it only searches captures after its first ply, so it misses
+// quiet mates otherwise. this makes the scores better, but looking at every quiescence node costs about 15% of the speed
+const bool QUIESCENCE_MATE_DETECTION = false;
+
+/*
+ * quiet moves near the leaves of the search are skipped when they are very unlikely to matter.
+ * the tables below are indexed by how many plies are left to search, so they need QUIET_PRUNING_DEPTH + 1 entries.
+ * nothing is skipped when the side to move is in check, when the move gives check, or on the first line the search looks at
+ */
+const int QUIET_PRUNING_DEPTH = 2;
+// after this many moves at a node, the rest of the quiet moves are skipped
+const int LATE_MOVE_COUNTS[QUIET_PRUNING_DEPTH + 1] = {0, 8, 14};
+// quiet moves with a history score below this are skipped.
+// a quiet move gains the square of the plies left when it causes a cutoff, and loses it when another move does
+const int HISTORY_PRUNING_THRESHOLDS[QUIET_PRUNING_DEPTH + 1] = {0, -4, -16};
+// history scores stay between -HISTORY_LIMIT and HISTORY_LIMIT
+const int HISTORY_LIMIT = 1 << 14;
+
+/*
+ * the transposition table remembers the scores of positions we already searched. it has two tiers.
+ * most nodes are close to the leaves, so they get a small front table that stays in the L2 cache.
+ * the deeper nodes get a big main table. a probe or a store only ever looks at the table for its depth
+ */
+// nodes with this many plies left or less use the front table
+const int TT_FRONT_DEPTH = 2;
+// 16 byte entries, so the front table is 256KB and the main table is 16MB
+const int TT_FRONT_ENTRIES = 1 << 14;
+const int TT_MAIN_ENTRIES = 1 << 20;
+// scores this close to MAX_EVAL or MIN_EVAL are checkmates
+const int MATE_THRESHOLD = 256;
+/*
+ * the main table can live in shared memory, so engine processes on the same machine use each other's work.
+ * change this whenever the layout of the shared table changes, so an old segment is not read the wrong way
+ */
+const uint32_t SHARED_TABLE_VERSION = 2;
+// how long to wait for another process to finish setting up the shared table before giving up on it
+const int SHARED_TABLE_WAIT_MS = 1000;
+
+/*
+ * keep a table of the attackers of every square on the board while searching, and update it a little after every move.
+ * then finding out if a square is attacked is one lookup. it is off by default, because updating the table
+ * after every move and unmove costs more than the lookups it saves
+ */
+const bool ATTACK_TABLES = false;
+
+// the settings "--autotune" found to be the fastest on this machine. loaded on startup if it exists
+const std::string ENGINE_CONFIG_FILE = "engine.cfg";
+/*
+ * the autotune bench plays a pawn push and then a knight move for each side (from and to squares),
+ * and searches the position every time it is the engine's turn.
+ * the player gets an extra knight move, because the player moves first if the engine is black
+ */
+const uint8_t BENCH_ENGINE_MOVES[2][2] = {{11, 27}, {1, 18}};
+const uint8_t BENCH_PLAYER_MOVES[3][2] = {{51, 35}, {62, 45}, {57, 42}};
+
+/*
+ * the evaluation network. the inputs are one per piece type and square, the hidden layer is clipped between 0 and 1,
+ * and the output times NETWORK_EVAL_SCALE is the score in centipawns.
+ * the weights are stored as integers: the hidden layer is multiplied by NETWORK_HIDDEN_SCALE
+ * and the output layer by NETWORK_OUTPUT_SCALE
+ */
+const std::string NETWORK_FILE = "network.bin";
+const int NETWORK_INPUTS = 12 * 64;
+const int NETWORK_HIDDEN = 64;
+const int NETWORK_HIDDEN_SCALE = 255;
+const int NETWORK_OUTPUT_SCALE = 64;
+const int NETWORK_EVAL_SCALE = 400;
+
+// how many positions the trainer looks at before it changes the weights, and how big those changes are
+const int TRAINING_BATCH_SIZE = 16384;
+const float TRAINING_LEARNING_RATE = 0.001f;
+// the trainer reads the dataset this many positions at a time, so it never has to fit in memory
+const int TRAINING_CHUNK_SIZE = TRAINING_BATCH_SIZE * 16;
+
+// the quiet position filter reads this many positions at a time and splits them between its threads
+const int QUIET_FILTER_CHUNK_SIZE = 1 << 16;
+
+// the learned quiet move ordering table. it is loaded on startup if it exists, and made with "--learn-prior"
+const std::string MOVE_PRIOR_FILE = "move_prior.bin";
+// the move ordering table is learned separately for the middlegame and the endgame
+const int PRIOR_PHASES = 2;
+// if there are this many knights, bishops, rooks and queens left or less, we are in the endgame
+const int PRIOR_ENDGAME_PIECES = 6;
+// pretend every move was possible this many more times than it was, so rare moves don't get a big score by luck
+const int PRIOR_SMOOTHING = 8;
+
 #define distance(ax, ay, bx, by) (int)(sqrt((ax - bx) * (ax - bx) + (ay - by) * (ay - by)))
 #define isOnBoard(row, col) (row >= 0 && row < 8 && col >= 0 && col < 8)
 
@@ -0,0 +1,444 @@
+//
+// Created by Joe Chrisman on 6/10/22.
+//
+
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "DistributedPerft.h"
+
+DistributedPerft::DistributedPerft(const std::string &fen, int depth, int splitDepth)
+{
+    this->fen = fen;
+    this->depth = std::max(depth, 1);
+    // a unit can't start deeper than the perft goes
+    this->splitDepth = std::min(std::max(splitDepth, 0), this->depth);
+}
+
+bool DistributedPerft::run(int workers, const std::string &checkpointPath, uint64_t &total)
+{
+    Board *board = new Board();
+    MoveGen *generator = new MoveGen(board);
+    Search search(generator);
+    if (!board->loadFen(fen))
+    {
+        return false;
+    }
+    units.clear();
+    findUnits(search, "-", 0);
+    if (!loadCheckpoint(checkpointPath))
+    {
+        return false;
+    }
+
+    std::ofstream checkpoint(checkpointPath, std::ios::app);
+    int remaining = 0;
+    for (Unit &unit : units)
+    {
+        remaining += !unit.done;
+    }
+    std::cout << units.size() << " units, " << units.size() - remaining << " done already" << std::endl;
+
+    if (remaining)
+    {
+        // let the system pick a free port, then ask it which one it picked
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        socklen_t length = sizeof(address);
+        if (listener < 0 || bind(listener, (sockaddr *)&address, sizeof(address)) < 0 || listen(listener, 64) < 0 ||
+            getsockname(listener, (sockaddr *)&address, &length) < 0)
+        {
+            return false;
+        }
+        int port = ntohs(address.sin_port);
+        std::cout << "listening on port " << port << ", more workers can join with --perft-worker " << port << std::endl;
+
+        std::vector<pid_t> children;
+        for (int worker = 0; worker < workers; worker++)
+        {
+            pid_t child = fork();
+            if (child == 0)
+            {
+                close(listener);
+                _exit(work(port) ? 0 : 1);
+            }
+            if (child > 0)
+            {
+                children.push_back(child);
+            }
+        }
+
+        std::vector<Connection> connections;
+        int nextUnit = 0;
+        int lastPercent = -1;
+        while (remaining)
+        {
+            // give every idle worker the next unit nobody has
+            for (Connection &connection : connections)
+            {
+                while (connection.unit < 0 && nextUnit < (int)units.size())
+                {
+                    Unit &unit = units[nextUnit];
+                    if (!unit.done && !unit.assigned)
+                    {
+                        if (sendText(connection.socket, "unit " + unit.line + " " + std::to_string(depth - splitDepth) + "\n"))
+                        {
+                            unit.assigned = true;
+                            connection.unit = nextUnit;
+                        }
+                        else
+                        {
+                            break;
+                        }
+                    }
+                    nextUnit++;
+                }
+            }
+
+            std::vector<pollfd> descriptors = {{listener, POLLIN, 0}};
+            for (Connection &connection : connections)
+            {
+                descriptors.push_back({connection.socket, POLLIN, 0});
+            }
+            // wake up once in a while to see if our workers are still alive
+            poll(descriptors.data(), descriptors.size(), 1000);
+
+            // only the connections we polled have revents. a worker accepted below waits for the next poll
+            for (int index = (int)descriptors.size() - 2; index >= 0; index--)
+            {
+                if (!(descriptors[index + 1].revents & (POLLIN | POLLHUP | POLLERR)))
+                {
+                    continue;
+                }
+                Connection &connection = connections[index];
+                char buffer[4096];
+                ssize_t received = recv(connection.socket, buffer, sizeof(buffer), 0);
+                if (received <= 0)
+                {
+                    // the worker is gone. put its unit back so somebody else does it
+                    if (connection.unit >= 0)
+                    {
+                        units[connection.unit].assigned = false;
+                        nextUnit = std::min(nextUnit, connection.unit);
+                    }
+                    close(connection.socket);
+                    connections.erase(connections.begin() + index);
+                    continue;
+                }
+                connection.received.append(buffer, received);
+
+                size_t end;
+                while ((end = connection.received.find('\n')) != std::string::npos)
+                {
+                    std::istringstream message(connection.received.substr(0, end));
+                    connection.received.erase(0, end + 1);
+                    std::string type, line;
+                    uint64_t positions;
+                    if (!(message >> type >> line >> positions) || type != "done" || connection.unit < 0)
+                    {
+                        continue;
+                    }
+                    Unit &unit = units[connection.unit];
+                    if (unit.line != line)
+                    {
+                        continue;
+                    }
+                    unit.done = true;
+                    unit.positions = positions;
+                    connection.unit = -1;
+                    remaining--;
+                    // write it down right away, so it survives whatever happens next
+                    checkpoint << unit.line << " " << positions << std::endl;
+
+                    int percent = (int)((units.size() - remaining) * 100 / units.size());
+                    if (percent != lastPercent)
+                    {
+                        lastPercent = percent;
+                        std::cout << percent << "% of the units done" << std::endl;
+                    }
+                }
+            }
+
+            if (descriptors[0].revents & POLLIN)
+            {
+                int client = accept(listener, nullptr, nullptr);
+                if (client >= 0 && sendText(client, "root " + fen + "\n"))
+                {
+                    connections.push_back(Connection{client, "", -1});
+                }
+            }
+
+            // if every worker we started is gone and nobody else is connected, nobody is going to finish the units
+            for (int index = (int)children.size() - 1; index >= 0; index--)
+            {
+                if (waitpid(children[index], nullptr, WNOHANG) == children[index])
+                {
+                    children.erase(children.begin() + index);
+                }
+            }
+            if (children.empty() && connections.empty() && remaining)
+            {
+                std::cout << "every worker is gone. run again with the same checkpoint file to pick up from here"
+                          << std::endl;
+                close(listener);
+                return false;
+            }
+        }
+
+        for (Connection &connection : connections)
+        {
+            sendText(connection.socket, "quit\n");
+            close(connection.socket);
+        }
+        close(listener);
+        for (pid_t child : children)
+        {
+            waitpid(child, nullptr, 0);
+        }
+    }
+
+    total = 0;
+    for (Unit &unit : units)
+    {
+        total += unit.positions;
+    }
+    return true;
+}
+
+bool DistributedPerft::work(int port)
+{
+    // making the move generator takes a while, so do it before we tell the coordinator we are here
+    Board *board = new Board();
+    MoveGen *generator = new MoveGen(board);
+    Search search(generator);
+
+    int coordinator = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (coordinator < 0 || connect(coordinator, (sockaddr *)&address, sizeof(address)) < 0)
+    {
+        return false;
+    }
+
+    std::string root;
+    std::string received;
+    char buffer[4096];
+    while (true)
+    {
+        size_t end;
+        while ((end = received.find('\n')) == std::string::npos)
+        {
+            ssize_t length = recv(coordinator, buffer, sizeof(buffer), 0);
+            if (length <= 0)
+            {
+                close(coordinator);
+                return false;
+            }
+            received.append(buffer, length);
+        }
+        std::string message = received.substr(0, end);
+        received.erase(0, end + 1);
+
+        std::istringstream stream(message);
+        std::string type;
+        stream >> type;
+        if (type == "quit")
+        {
+            close(coordinator);
+            return true;
+        }
+        if (type == "root")
+        {
+            std::getline(stream, root);
+            continue;
+        }
+
+        std::string line;
+        int unitDepth;
+        if (type != "unit" || !(stream >> line >> unitDepth) || !board->loadFen(root) ||
+            !playLine(search, line))
+        {
+            close(coordinator);
+            return false;
+        }
+        uint64_t positions = unitDepth ? search.perft(unitDepth) : 1;
+        if (!sendText(coordinator, "done " + line + " " + std::to_string(positions) + "\n"))
+        {
+            close(coordinator);
+            return false;
+        }
+    }
+}
+
+void DistributedPerft::findUnits(Search &search, std::string line, int plies)
+{
+    if (plies == splitDepth)
+    {
+        units.push_back(Unit{line, false, false, 0});
+        return;
+    }
+
+    Board *board = search.board;
+    MoveGen *generator = search.generator;
+    bool isEngine = board->engineToMove;
+    if (isEngine)
+    {
+        generator->generateEngineMoves();
+    }
+    else
+    {
+        generator->generatePlayerMoves();
+    }
+    std::vector<Board::Move> moves = generator->getSortedMoves();
+    for (Board::Move &move : moves)
+    {
+        if (!generator->isLegalMove(move))
+        {
+            continue;
+        }
+        Board::Position clone = board->position;
+        if (isEngine)
+        {
+            board->makeMove<true>(move);
+        }
+        else
+        {
+            board->makeMove<false>(move);
+        }
+        findUnits(search, line == "-" ? getMoveText(move) : line + "," + getMoveText(move), plies + 1);
+        board->restore(clone);
+    }
+}
+
+bool DistributedPerft::loadCheckpoint(const std::string &path)
+{
+    std::string header = "perft " + std::to_string(depth) + " " + std::to_string(splitDepth) + " " + fen;
+    std::ifstream file(path);
+    if (file)
+    {
+        std::stringstream contents;
+        contents << file.rdbuf();
+        std::string text = contents.str();
+
+        size_t end = text.find('\n');
+        if (end == std::string::npos || text.substr(0, end) != header)
+        {
+            std::cout << path << " is the checkpoint of a different perft" << std::endl;
+            return false;
+        }
+
+        std::unordered_map<std::string, int> indices;
+        for (int index = 0; index < (int)units.size(); index++)
+        {
+            indices[units[index].line] = index;
+        }
+        // a crash can cut off the last line, so only the lines with a newline after them count
+        size_t start = end + 1;
+        while ((end = text.find('\n', start)) != std::string::npos)
+        {
+            std::istringstream stream(text.substr(start, end - start));
+            start = end + 1;
+            std::string line;
+            uint64_t positions;
+            if (!(stream >> line >> positions))
+            {
+                continue;
+            }
+            auto found = indices.find(line);
+            if (found != indices.end())
+            {
+                units[found->second].done = true;
+                units[found->second].positions = positions;
+            }
+        }
+    }
+
+    // write the checkpoint again without the cut off line, so new lines don't get glued onto it
+    std::ofstream rewritten(path);
+    rewritten << header << std::endl;
+    for (Unit &unit : units)
+    {
+        if (unit.done)
+        {
+            rewritten << unit.line << " " << unit.positions << std::endl;
+        }
+    }
+    return rewritten.good();
+}
+
+bool DistributedPerft::playLine(Search &search, const std::string &line)
+{
+    Board *board = search.board;
+    MoveGen *generator = search.generator;
+    std::istringstream stream(line == "-" ? "" : line);
+    std::string text;
+    while (std::getline(stream, text, ','))
+    {
+        bool isEngine = board->engineToMove;
+        board->update();
+        if (isEngine)
+        {
+            generator->generateEngineMoves();
+        }
+        else
+        {
+            generator->generatePlayerMoves();
+        }
+
+        bool played = false;
+        for (Board::Move &move : generator->getGeneratedMoves())
+        {
+            if (getMoveText(move) == text && generator->isLegalMove(move))
+            {
+                Board::Move copy = move;
+                if (isEngine)
+                {
+                    board->makeMove<true>(copy);
+                }
+                else
+                {
+                    board->makeMove<false>(copy);
+                }
+                played = true;
+                break;
+            }
+        }
+        if (!played)
+        {
+            return false;
+        }
+    }
+    board->update();
+    return true;
+}
+
+std::string DistributedPerft::getMoveText(Board::Move &move)
+{
+    return std::to_string(move.from) + "-" + std::to_string(move.to) + "-" + std::to_string(move.type);
+}
+
+bool DistributedPerft::sendText(int socket, const std::string &text)
+{
+    size_t sent = 0;
+    while (sent < text.size())
+    {
+        ssize_t written = send(socket, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0)
+        {
+            return false;
+        }
+        sent += written;
+    }
+    return true;
+}
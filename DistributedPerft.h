@@ -0,0 +1,77 @@
+//
+// Created by Joe Chrisman on 6/10/22.
+//
+
+#ifndef UNTITLED2_DISTRIBUTEDPERFT_H
+#define UNTITLED2_DISTRIBUTEDPERFT_H
+
+#include "Search.h"
+
+/*
+ * a deep perft takes hours, so this splits it between worker processes on the same machine.
+ *
+ * the coordinator plays every line of splitDepth moves from the root, and each of those lines is a unit of work:
+ * a perft of the rest of the depth from the end of the line. the workers connect to the coordinator over a local
+ * socket, and get one unit at a time. a unit is sent as the root position and the moves of its line,
+ * so the workers don't need to know how to read anything but a FEN.
+ *
+ * every finished unit is written to a checkpoint file right away. if the run stops for any reason,
+ * running it again with the same checkpoint file only does the units that are not in it yet.
+ * if a worker dies, its unit goes back to the others.
+ *
+ * the messages are lines of text:
+ * coordinator to worker: "root <fen>", then "unit <line> <depth>" for every unit, and "quit" at the end.
+ * worker to coordinator: "done <line> <positions>" for every unit.
+ * a line is the moves from the root as from-to-type, separated by commas, or "-" for the root itself
+ */
+class DistributedPerft
+{
+public:
+    DistributedPerft(const std::string &fen, int depth, int splitDepth);
+
+    /*
+     * split the perft into units, start the given number of worker processes, and hand out the units until they
+     * are all done. more workers can join with work() while it runs. returns false if the position is not valid,
+     * the checkpoint file belongs to a different perft, or we can't listen on a local port
+     */
+    bool run(int workers, const std::string &checkpointPath, uint64_t &total);
+
+    // be a worker for the coordinator on the given local port, until it says to quit or goes away
+    static bool work(int port);
+
+private:
+    std::string fen;
+    int depth;
+    int splitDepth;
+
+    struct Unit
+    {
+        std::string line;
+        bool done;
+        bool assigned;
+        uint64_t positions;
+    };
+    std::vector<Unit> units;
+
+    // what the coordinator knows about one connected worker
+    struct Connection
+    {
+        int socket;
+        std::string received; // the text after the last complete line
+        int unit; // the unit the worker is counting, or -1
+    };
+
+    // find every line of splitDepth moves from the root. lines that end in checkmate or stalemate early are left out
+    void findUnits(Search &search, std::string line, int plies);
+    // read the units a previous run finished, or start a new checkpoint. returns false if the file is about a different perft
+    bool loadCheckpoint(const std::string &path);
+
+    // play the moves of a line on the board. returns false if one of them is not a legal move
+    static bool playLine(Search &search, const std::string &line);
+    static std::string getMoveText(Board::Move &move);
+    // send a whole string, even if the socket takes it a piece at a time
+    static bool sendText(int socket, const std::string &text);
+};
+
+
+#endif //UNTITLED2_DISTRIBUTEDPERFT_H
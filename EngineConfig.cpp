@@ -0,0 +1,199 @@
+//
+// Created by Joe Chrisman on 5/29/22.
+//
+
+#include <fstream>
+#include <sstream>
+#include "EngineConfig.h"
+
+EngineConfig::EngineConfig()
+{
+    pseudoLegalGeneration = PSEUDO_LEGAL_GENERATION;
+    mateInOneDetection = MATE_IN_ONE_DETECTION;
+    attackTables = ATTACK_TABLES;
+    flippedGeneration = FLIPPED_GENERATION;
+}
+
+bool EngineConfig::load(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream stream(line);
+        std::string name;
+        int value;
+        if (!(stream >> name >> value))
+        {
+            continue;
+        }
+        if (name == "pseudo_legal_generation")
+        {
+            pseudoLegalGeneration = value;
+        }
+        else if (name == "mate_in_one_detection")
+        {
+            mateInOneDetection = value;
+        }
+        else if (name == "attack_tables")
+        {
+            attackTables = value;
+        }
+        else if (name == "flipped_generation")
+        {
+            flippedGeneration = value;
+        }
+    }
+    return true;
+}
+
+bool EngineConfig::save(const std::string &path)
+{
+    std::ofstream file(path);
+    file << "pseudo_legal_generation " << pseudoLegalGeneration << std::endl;
+    file << "mate_in_one_detection " << mateInOneDetection << std::endl;
+    file << "attack_tables " << attackTables << std::endl;
+    file << "flipped_generation " << flippedGeneration << std::endl;
+    return file.good();
+}
+
+void EngineConfig::apply(Search *search)
+{
+    search->generator->pseudoLegal = pseudoLegalGeneration;
+    search->mateInOneDetection = mateInOneDetection;
+    search->attackTables = attackTables;
+    search->generator->flippedGeneration = flippedGeneration;
+}
+
+void EngineConfig::autotune(Search *search)
+{
+    EngineConfig best;
+    int64_t bestMilliseconds = INT64_MAX;
+
+    for (int pseudoLegal = 0; pseudoLegal < 2; pseudoLegal++)
+    {
+        for (int mateInOne = 0; mateInOne < 2; mateInOne++)
+        {
+            for (int tables = 0; tables < 2; tables++)
+            {
+                for (int flipped = 0; flipped < 2; flipped++)
+                {
+                    EngineConfig candidate;
+                    candidate.pseudoLegalGeneration = pseudoLegal;
+                    candidate.mateInOneDetection = mateInOne;
+                    candidate.attackTables = tables;
+                    candidate.flippedGeneration = flipped;
+                    candidate.apply(search);
+
+                    int64_t milliseconds;
+                    uint64_t nodes;
+                    candidate.benchmark(search, milliseconds, nodes);
+                    std::cout << candidate.describe() << ": " << nodes << " nodes in " << milliseconds << "ms to depth "
+                              << SEARCH_DEPTH << ", " << nodes * 1000 / std::max(milliseconds, (int64_t)1) << " nodes/s" << std::endl;
+
+                    if (milliseconds < bestMilliseconds)
+                    {
+                        bestMilliseconds = milliseconds;
+                        best = candidate;
+                    }
+                }
+            }
+        }
+    }
+
+    *this = best;
+    apply(search);
+    std::cout << "fastest: " << describe() << std::endl;
+}
+
+void EngineConfig::benchmark(Search *search, int64_t &milliseconds, uint64_t &nodes)
+{
+    Board *board = search->board;
+    MoveGen *generator = search->generator;
+
+    Board initial;
+    board->position = initial.position;
+    board->engineToMove = initial.engineToMove;
+    board->update();
+
+    milliseconds = 0;
+    nodes = 0;
+    // only the totals get printed here, not every root move
+    bool wasQuiet = search->quiet;
+    search->quiet = true;
+
+    // play a bench move for whoever's turn it is
+    auto playMove = [&](const uint8_t squares[2])
+    {
+        // the search unmakes its moves without updating the extra bitboards
+        board->update();
+        bool isEngine = board->engineToMove;
+        if (isEngine)
+        {
+            generator->generateEngineMoves();
+        }
+        else
+        {
+            generator->generatePlayerMoves();
+        }
+        for (Board::Move &move : generator->getGeneratedMoves())
+        {
+            if (move.from == squares[0] && move.to == squares[1])
+            {
+                Board::Move played = move;
+                if (isEngine)
+                {
+                    board->makeMove<true>(played);
+                }
+                else
+                {
+                    board->makeMove<false>(played);
+                }
+                return;
+            }
+        }
+    };
+
+    int playerMoves = 0;
+    for (int engineMoves = 0; ; engineMoves++)
+    {
+        if (!board->engineToMove)
+        {
+            playMove(BENCH_PLAYER_MOVES[playerMoves++]);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        search->getBestMove();
+        auto end = std::chrono::steady_clock::now();
+
+        milliseconds += std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        nodes += search->stats.nodes;
+
+        if (engineMoves == 2)
+        {
+            break;
+        }
+        playMove(BENCH_ENGINE_MOVES[engineMoves]);
+        if (!board->engineToMove)
+        {
+            playMove(BENCH_PLAYER_MOVES[playerMoves++]);
+        }
+    }
+
+    search->quiet = wasQuiet;
+    board->position = initial.position;
+    board->engineToMove = initial.engineToMove;
+    board->update();
+}
+
+std::string EngineConfig::describe()
+{
+    return std::string(pseudoLegalGeneration ? "pseudo legal" : "legal") + " generation, mate in one detection " +
+           (mateInOneDetection ? "on" : "off") + ", attack tables " + (attackTables ? "on" : "off") +
+           ", flipped generation " + (flippedGeneration ? "on" : "off");
+}
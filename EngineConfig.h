@@ -0,0 +1,52 @@
+//
+// Created by Joe Chrisman on 5/29/22.
+//
+
+#ifndef UNTITLED2_ENGINECONFIG_H
+#define UNTITLED2_ENGINECONFIG_H
+
+#include "Search.h"
+
+/*
+ * the settings that change how fast the engine is. pseudo legal generation and attack tables only change the speed.
+ * mate in one detection cuts the search short at nodes with a mate, and flipped generation generates the player's moves
+ * in a different order, so those two search a different tree. flipped generation can even find a different move.
+ * which ones are fastest depends on the machine, so "--autotune" tries all of them with a short bench, prints the nodes
+ * next to the times so a smaller tree isn't mistaken for a faster search, and saves the fastest to ENGINE_CONFIG_FILE.
+ * the game loads that file on startup.
+ *
+ * the file is one setting per line, the name and then the value. settings that are missing keep their defaults
+ */
+class EngineConfig
+{
+public:
+    // start with the defaults in Constants.h
+    EngineConfig();
+
+    bool pseudoLegalGeneration;
+    bool mateInOneDetection;
+    bool attackTables;
+    bool flippedGeneration;
+
+    bool load(const std::string &path);
+    bool save(const std::string &path);
+
+    // give these settings to the search and its move generator
+    void apply(Search *search);
+
+    // bench every combination of settings, print how each one did, and keep the fastest
+    void autotune(Search *search);
+
+private:
+
+    /*
+     * search a few positions from the start of a game to SEARCH_DEPTH, and measure how long it took and how many
+     * nodes were searched. the board is left in the initial position
+     */
+    void benchmark(Search *search, int64_t &milliseconds, uint64_t &nodes);
+
+    std::string describe();
+};
+
+
+#endif //UNTITLED2_ENGINECONFIG_H
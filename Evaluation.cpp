@@ -4,11 +4,21 @@
 
 #include "Evaluation.h"
 
+Evaluation::Evaluation()
+{
+    network = nullptr;
+}
+
 /*
  * return a positive value when the engine is winning, and a negative value when the engine is losing
  */
 int Evaluation::evaluate(Board::Position &position)
 {
+    if (network)
+    {
+        return network->evaluate(position);
+    }
+
     int score = 0;
 
     // first, calculate material score for both sides
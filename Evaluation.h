@@ -5,11 +5,15 @@
 #ifndef UNTITLED2_EVALUATION_H
 #define UNTITLED2_EVALUATION_H
 
-#include "Board.h"
+#include "Network.h"
 
 class Evaluation {
 
 public:
+    Evaluation();
+
+    // if somebody trained a network, it scores the positions instead of the hand written terms below
+    Network *network;
 
     int evaluate(Board::Position &position);
 };
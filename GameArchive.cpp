@@ -0,0 +1,227 @@
+//
+// Created by Joe Chrisman on 5/21/22.
+//
+
+#include <fstream>
+#include <iterator>
+#include "GameArchive.h"
+
+GameArchive::GameArchive(MoveGen *generator)
+{
+    this->generator = generator;
+    this->board = generator->board;
+}
+
+bool GameArchive::encode(std::vector<Board::Move> &moves, bool packed, std::vector<uint8_t> &data)
+{
+    // the number of moves has to fit in the two bytes of the header
+    if (moves.size() > 0xffff)
+    {
+        return false;
+    }
+    Board::Position saved = board->position;
+    bool savedEngineToMove = board->engineToMove;
+    reset();
+
+    data.clear();
+    data.push_back(moves.size() & 0xff);
+    data.push_back(moves.size() >> 8 & 0xff);
+    data.push_back(packed);
+
+    // packed indices are written into this, lowest bit first, and flushed a byte at a time
+    uint64_t bitBuffer = 0;
+    int bufferedBits = 0;
+
+    std::vector<Board::Move> legal;
+    bool isLegal = true;
+    for (Board::Move &move : moves)
+    {
+        generateLegalMoves(legal);
+
+        size_t index = 0;
+        while (index < legal.size() &&
+               (legal[index].from != move.from || legal[index].to != move.to || legal[index].type != move.type))
+        {
+            index++;
+        }
+        // the move has to be one of the legal moves, otherwise the game can't be stored
+        if (index == legal.size())
+        {
+            isLegal = false;
+            break;
+        }
+
+        if (packed)
+        {
+            bitBuffer |= (uint64_t)index << bufferedBits;
+            bufferedBits += getIndexBits(legal.size());
+            while (bufferedBits >= 8)
+            {
+                data.push_back(bitBuffer & 0xff);
+                bitBuffer >>= 8;
+                bufferedBits -= 8;
+            }
+        }
+        else
+        {
+            data.push_back(index);
+        }
+        makeMove(legal[index]);
+    }
+    if (bufferedBits)
+    {
+        data.push_back(bitBuffer & 0xff);
+    }
+
+    board->position = saved;
+    board->engineToMove = savedEngineToMove;
+    board->update();
+    return isLegal;
+}
+
+std::vector<Board::Move> GameArchive::decode(std::vector<uint8_t> &data, size_t &offset)
+{
+    std::vector<Board::Move> moves;
+    // not even a header left
+    if (offset + 3 > data.size())
+    {
+        offset = data.size();
+        return moves;
+    }
+
+    Board::Position saved = board->position;
+    bool savedEngineToMove = board->engineToMove;
+    reset();
+
+    int moveCount = data[offset] | data[offset + 1] << 8;
+    bool packed = data[offset + 2];
+    offset += 3;
+
+    uint64_t bitBuffer = 0;
+    int bufferedBits = 0;
+
+    std::vector<Board::Move> legal;
+    for (int count = 0; count < moveCount; count++)
+    {
+        generateLegalMoves(legal);
+
+        size_t index;
+        if (packed)
+        {
+            int bits = getIndexBits(legal.size());
+            while (bufferedBits < bits && offset < data.size())
+            {
+                bitBuffer |= (uint64_t)data[offset++] << bufferedBits;
+                bufferedBits += 8;
+            }
+            index = bitBuffer & (((uint64_t)1 << bits) - 1);
+            bitBuffer >>= bits;
+            bufferedBits -= bits;
+        }
+        else
+        {
+            index = offset < data.size() ? data[offset++] : legal.size();
+        }
+
+        // the data is cut off or was written by a different move generator
+        if (index >= legal.size())
+        {
+            offset = data.size();
+            break;
+        }
+        moves.push_back(legal[index]);
+        makeMove(legal[index]);
+    }
+    // any bits left over are just padding from the last byte of the game
+
+    board->position = saved;
+    board->engineToMove = savedEngineToMove;
+    board->update();
+    return moves;
+}
+
+bool GameArchive::save(const std::string &path, std::vector<std::vector<Board::Move>> &games, bool packed)
+{
+    // encode every game before touching the file, so a game that can't be stored doesn't leave half an archive
+    std::vector<uint8_t> archive;
+    std::vector<uint8_t> data;
+    for (std::vector<Board::Move> &game : games)
+    {
+        if (!encode(game, packed, data))
+        {
+            return false;
+        }
+        archive.insert(archive.end(), data.begin(), data.end());
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    file.write((const char *)archive.data(), archive.size());
+    return file.good();
+}
+
+std::vector<std::vector<Board::Move>> GameArchive::load(const std::string &path)
+{
+    std::vector<std::vector<Board::Move>> games;
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return games;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    size_t offset = 0;
+    while (offset < data.size())
+    {
+        games.push_back(decode(data, offset));
+    }
+    return games;
+}
+
+void GameArchive::reset()
+{
+    Board initial;
+    board->position = initial.position;
+    board->engineToMove = initial.engineToMove;
+    board->update();
+}
+
+void GameArchive::generateLegalMoves(std::vector<Board::Move> &legal)
+{
+    /*
+     * flipped and pseudo legal generation make the moves in a different order, and those are settings engine.cfg
+     * can change. the indices have to mean the same thing on every machine, so always use the normal generator
+     */
+    bool flippedGeneration = generator->flippedGeneration;
+    bool pseudoLegal = generator->pseudoLegal;
+    generator->flippedGeneration = false;
+    generator->pseudoLegal = false;
+    if (board->engineToMove)
+    {
+        generator->generateEngineMoves();
+    }
+    else
+    {
+        generator->generatePlayerMoves();
+    }
+
+    // every generated move is legal now
+    legal = generator->getGeneratedMoves();
+    generator->flippedGeneration = flippedGeneration;
+    generator->pseudoLegal = pseudoLegal;
+}
+
+void GameArchive::makeMove(Board::Move &move)
+{
+    if (board->engineToMove)
+    {
+        board->makeMove<true>(move);
+    }
+    else
+    {
+        board->makeMove<false>(move);
+    }
+}
@@ -0,0 +1,72 @@
+//
+// Created by Joe Chrisman on 5/21/22.
+//
+
+#ifndef UNTITLED2_GAMEARCHIVE_H
+#define UNTITLED2_GAMEARCHIVE_H
+
+#include "MoveGen.h"
+
+/*
+ * a very small way to store whole games. instead of storing the moves themselves, we store the index of each
+ * move in the list of legal moves the move generator makes for that position. the move generator always makes its
+ * moves in the same order, so the index is all we need to get the move back, as long as we replay the game from the start.
+ *
+ * there are never more than 218 legal moves in a chess position, so every index fits in a byte.
+ * when a game is packed, each index only gets as many bits as it takes to count the legal moves in its position.
+ * a position with 20 legal moves needs 5 bits, and a forced move needs no bits at all.
+ *
+ * an encoded game looks like this:
+ * 2 bytes - the number of moves in the game (little endian)
+ * 1 byte  - 1 if the indices are packed, 0 if every index is a byte
+ * the indices
+ *
+ * an archive is just encoded games one after another. games always start from the initial position.
+ * since the indices depend on the order the move generator makes moves in, changing that order
+ * makes old archives unreadable. the archive always uses the normal legal generator, whatever engine.cfg says
+ */
+class GameArchive
+{
+public:
+    GameArchive(MoveGen *generator);
+
+    MoveGen *generator;
+    Board *board;
+
+    /*
+     * turn a game into bytes. the board is left how it was found.
+     * returns false if one of the moves is not legal in its position, or the game is longer than 65535 moves
+     */
+    bool encode(std::vector<Board::Move> &moves, bool packed, std::vector<uint8_t> &data);
+
+    // turn the game starting at offset back into moves. offset is moved to the start of the next game
+    std::vector<Board::Move> decode(std::vector<uint8_t> &data, size_t &offset);
+
+    // returns false if a game can't be encoded or the file can't be written. the file is not touched if a game can't be encoded
+    bool save(const std::string &path, std::vector<std::vector<Board::Move>> &games, bool packed);
+    std::vector<std::vector<Board::Move>> load(const std::string &path);
+
+private:
+
+    // put the board in the initial position
+    void reset();
+
+    // generate moves for the side to move, and throw away the ones that leave our king in check
+    void generateLegalMoves(std::vector<Board::Move> &legal);
+
+    void makeMove(Board::Move &move);
+
+    // how many bits it takes to write any index below the given number of moves
+    static inline int getIndexBits(size_t moveCount)
+    {
+        int bits = 0;
+        while ((size_t)1 << bits < moveCount)
+        {
+            bits++;
+        }
+        return bits;
+    }
+};
+
+
+#endif //UNTITLED2_GAMEARCHIVE_H
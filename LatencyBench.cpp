@@ -0,0 +1,136 @@
+//
+// Created by Joe Chrisman on 6/7/22.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include "LatencyBench.h"
+
+LatencyBench::LatencyBench(Search *search)
+{
+    this->search = search;
+}
+
+bool LatencyBench::run(const std::string &archivePath, const std::string &csvPath)
+{
+    Board *board = search->board;
+    GameArchive archive(search->generator);
+    std::vector<std::vector<Board::Move>> games = archive.load(archivePath);
+    if (games.empty())
+    {
+        return false;
+    }
+
+    samples.clear();
+    for (int game = 0; game < (int)games.size(); game++)
+    {
+        Board initial;
+        board->position = initial.position;
+        board->engineToMove = initial.engineToMove;
+        board->update();
+
+        for (int ply = 0; ply < (int)games[game].size(); ply++)
+        {
+            Board::Move &move = games[game][ply];
+            if (board->engineToMove)
+            {
+                samples.push_back(measureMove(game, ply));
+                // the search unmakes its moves without updating the extra bitboards
+                board->update();
+                board->makeMove<true>(move);
+            }
+            else
+            {
+                board->makeMove<false>(move);
+            }
+        }
+    }
+
+    if (!csvPath.empty())
+    {
+        std::ofstream file(csvPath);
+        file << "game,ply,milliseconds,slices,max_ply,nodes" << std::endl;
+        for (MoveSample &sample : samples)
+        {
+            file << sample.game << "," << sample.ply << "," << sample.milliseconds << "," << sample.slices << ","
+                 << sample.maxPly << "," << sample.nodes << std::endl;
+        }
+        if (!file)
+        {
+            return false;
+        }
+    }
+
+    printReport();
+    return true;
+}
+
+LatencyBench::MoveSample LatencyBench::measureMove(int game, int ply)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    int slices = 1;
+    if (TIME_SLICED_SEARCH)
+    {
+        // the game gives the search one slice per frame. here the slices run back to back
+        search->startSearch();
+        while (!search->continueSearch(SEARCH_SLICE_MS))
+        {
+            slices++;
+        }
+    }
+    else
+    {
+        search->getBestMove();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    return MoveSample{
+        game,
+        ply,
+        std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count(),
+        slices,
+        search->stats.maxPly,
+        search->stats.nodes
+    };
+}
+
+void LatencyBench::printReport()
+{
+    if (samples.empty())
+    {
+        std::cout << "the engine never had to move" << std::endl;
+        return;
+    }
+
+    std::vector<int64_t> latencies;
+    int64_t totalMilliseconds = 0;
+    uint64_t totalNodes = 0;
+    int overruns = 0;
+    for (MoveSample &sample : samples)
+    {
+        latencies.push_back(sample.milliseconds);
+        totalMilliseconds += sample.milliseconds;
+        totalNodes += sample.nodes;
+        if (sample.milliseconds > MOVE_DEADLINE_MS)
+        {
+            overruns++;
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    // the smallest latency that at least the given percent of the moves are at or under
+    auto getPercentile = [&](int percent)
+    {
+        int rank = (int)std::ceil(percent / 100.0 * latencies.size());
+        return latencies[std::max(rank, 1) - 1];
+    };
+
+    std::cout << samples.size() << " engine moves, " << totalNodes * 1000 / std::max(totalMilliseconds, (int64_t)1)
+              << " nodes/s" << std::endl;
+    std::cout << "move latency: p50 " << getPercentile(50) << "ms, p90 " << getPercentile(90) << "ms, p99 "
+              << getPercentile(99) << "ms, max " << latencies.back() << "ms" << std::endl;
+    std::cout << overruns << " moves over the " << MOVE_DEADLINE_MS << "ms deadline" << std::endl;
+}
@@ -0,0 +1,50 @@
+//
+// Created by Joe Chrisman on 6/7/22.
+//
+
+#ifndef UNTITLED2_LATENCYBENCH_H
+#define UNTITLED2_LATENCYBENCH_H
+
+#include "GameArchive.h"
+#include "Search.h"
+
+/*
+ * the average speed of the search hides the few moves that take much longer than the rest, and those are the ones
+ * people notice. this replays the games of a GameArchive, searches every position where it is the engine's turn
+ * exactly like the game would (with TIME_SLICED_SEARCH, SEARCH_SLICE_MS and whatever settings the search was given),
+ * and measures every one of those searches.
+ *
+ * the archived moves are played no matter what the engine found, so every run searches the same positions
+ */
+class LatencyBench
+{
+public:
+    LatencyBench(Search *search);
+
+    // what we measured for one engine move
+    struct MoveSample
+    {
+        int game;
+        int ply; // how many moves of the game were played before this one
+        int64_t milliseconds; // wall time from the start of the search to the move
+        int slices; // how many calls to continueSearch() it took. 1 when the search is not time sliced
+        int maxPly; // the deepest ply the search reached, quiescence included
+        uint64_t nodes;
+    };
+
+    /*
+     * measure every engine move in the archive. if csvPath is not empty, every sample is written there too.
+     * prints the latency percentiles, the moves slower than MOVE_DEADLINE_MS and the overall nodes per second
+     */
+    bool run(const std::string &archivePath, const std::string &csvPath);
+
+private:
+    Search *search;
+    std::vector<MoveSample> samples;
+
+    MoveSample measureMove(int game, int ply);
+    void printReport();
+};
+
+
+#endif //UNTITLED2_LATENCYBENCH_H
@@ -0,0 +1,203 @@
+//
+// Created by Joe Chrisman on 6/8/22.
+//
+
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "Metrics.h"
+
+Metrics::Metrics()
+{
+    queued = 0;
+}
+
+void Metrics::Worker::addSearch(uint64_t searchNodes, uint64_t microseconds)
+{
+    int bucket = 0;
+    while (bucket < METRICS_LATENCY_BUCKET_COUNT && microseconds > METRICS_LATENCY_BUCKETS_MS[bucket] * 1000ull)
+    {
+        bucket++;
+    }
+    // we are the only writer, so there is nothing to wait for. the server just has to see whole numbers
+    latencyBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    latencyMicroseconds.fetch_add(microseconds, std::memory_order_relaxed);
+    nodes.fetch_add(searchNodes, std::memory_order_relaxed);
+    searches.fetch_add(1, std::memory_order_relaxed);
+}
+
+Metrics::Worker *Metrics::addWorker()
+{
+    // the parentheses start every number at zero
+    workers.push_back(new Worker());
+    return workers.back();
+}
+
+bool Metrics::serve(int port)
+{
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    if (server < 0)
+    {
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // only this machine can see the metrics
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (bind(server, (sockaddr *)&address, sizeof(address)) < 0 || listen(server, 8) < 0)
+    {
+        close(server);
+        return false;
+    }
+
+    // one scrape at a time is plenty. the thread runs until the program exits
+    std::thread([this, server]()
+    {
+        // a client that connects and never says anything would keep everybody else waiting, so give up on it
+        timeval timeout{METRICS_CLIENT_TIMEOUT_MS / 1000, METRICS_CLIENT_TIMEOUT_MS % 1000 * 1000};
+        while (true)
+        {
+            int client = accept(server, nullptr, nullptr);
+            if (client >= 0)
+            {
+                setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+                respond(client);
+                close(client);
+            }
+        }
+    }).detach();
+    return true;
+}
+
+void Metrics::respond(int client)
+{
+    // we only need the first line of the request
+    char request[1024];
+    ssize_t length = recv(client, request, sizeof(request) - 1, 0);
+    if (length <= 0)
+    {
+        return;
+    }
+    request[length] = 0;
+
+    std::string status = "200 OK";
+    std::string body;
+    if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET / ", 6) == 0)
+    {
+        body = getText();
+    }
+    else
+    {
+        status = "404 Not Found";
+        body = "only /metrics is here\n";
+    }
+
+    std::string response = "HTTP/1.0 " + status + "\r\n"
+                           "Content-Type: text/plain; version=0.0.4\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n" + body;
+    size_t sent = 0;
+    while (sent < response.size())
+    {
+        ssize_t written = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0)
+        {
+            return;
+        }
+        sent += written;
+    }
+}
+
+std::string Metrics::getText()
+{
+    std::ostringstream text;
+
+    // the name, help and type lines come before the samples of every metric
+    auto describe = [&](const char *name, const char *type, const char *help)
+    {
+        text << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+    };
+    // one sample for every worker, labelled with its index
+    auto perWorker = [&](const char *name, const char *type, const char *help, auto getValue)
+    {
+        describe(name, type, help);
+        for (int index = 0; index < (int)workers.size(); index++)
+        {
+            text << name << "{worker=\"" << index << "\"} " << getValue(*workers[index]) << "\n";
+        }
+    };
+    auto load = [](std::atomic<uint64_t> &value)
+    {
+        return value.load(std::memory_order_relaxed);
+    };
+
+    uint64_t inFlight = 0;
+    uint64_t finishedJobs = 0;
+    for (Worker *worker : workers)
+    {
+        inFlight += worker->searching.load(std::memory_order_relaxed);
+        finishedJobs += load(worker->jobs);
+    }
+    describe("engine_searches_in_flight", "gauge", "Searches running right now.");
+    text << "engine_searches_in_flight " << inFlight << "\n";
+    // a worker can finish a job before we read the queue, so don't go below zero
+    uint64_t queuedJobs = load(queued);
+    describe("engine_queue_depth", "gauge", "Jobs handed out that no worker has finished yet.");
+    text << "engine_queue_depth " << (queuedJobs > finishedJobs ? queuedJobs - finishedJobs : 0) << "\n";
+
+    perWorker("engine_searches_total", "counter", "Searches finished.",
+              [&](Worker &worker) { return load(worker.searches); });
+    perWorker("engine_nodes_total", "counter", "Nodes searched. The rate of this is the nodes per second.",
+              [&](Worker &worker) { return load(worker.nodes); });
+    perWorker("engine_busy_seconds_total", "counter", "Time spent searching. The rate of this is the utilisation.",
+              [&](Worker &worker) { return load(worker.busyMicroseconds) / 1e6; });
+    perWorker("engine_jobs_total", "counter", "Queued jobs finished.",
+              [&](Worker &worker) { return load(worker.jobs); });
+    perWorker("engine_deadlines_missed_total", "counter", "Queued jobs finished after their deadline.",
+              [&](Worker &worker) { return load(worker.deadlinesMissed); });
+    perWorker("engine_tt_probes_total", "counter", "Transposition table probes.",
+              [&](Worker &worker) { return load(worker.tableProbes); });
+    perWorker("engine_tt_hits_total", "counter", "Transposition table probes that found the position.",
+              [&](Worker &worker) { return load(worker.tableHits); });
+    perWorker("engine_tt_fill_ratio", "gauge", "How full the transposition table was after the last search.",
+              [&](Worker &worker) { return load(worker.tableFilled) / (double)(TT_FRONT_ENTRIES + TT_MAIN_ENTRIES); });
+
+    // prometheus histograms count every sample at or under each bound, so the buckets add up as we go
+    describe("engine_move_latency_seconds", "histogram", "Wall time from the start of a search to its move.");
+    uint64_t cumulative = 0;
+    for (int bucket = 0; bucket <= METRICS_LATENCY_BUCKET_COUNT; bucket++)
+    {
+        for (Worker *worker : workers)
+        {
+            cumulative += load(worker->latencyBuckets[bucket]);
+        }
+        text << "engine_move_latency_seconds_bucket{le=\"";
+        if (bucket < METRICS_LATENCY_BUCKET_COUNT)
+        {
+            text << METRICS_LATENCY_BUCKETS_MS[bucket] / 1000.0;
+        }
+        else
+        {
+            text << "+Inf";
+        }
+        text << "\"} " << cumulative << "\n";
+    }
+    uint64_t latencyMicroseconds = 0;
+    for (Worker *worker : workers)
+    {
+        latencyMicroseconds += load(worker->latencyMicroseconds);
+    }
+    text << "engine_move_latency_seconds_sum " << latencyMicroseconds / 1e6 << "\n";
+    text << "engine_move_latency_seconds_count " << cumulative << "\n";
+
+    return text.str();
+}
@@ -0,0 +1,70 @@
+//
+// Created by Joe Chrisman on 6/8/22.
+//
+
+#ifndef UNTITLED2_METRICS_H
+#define UNTITLED2_METRICS_H
+
+#include <atomic>
+#include "Constants.h"
+
+/*
+ * numbers for watching a long running engine from the outside. serve() answers "GET /metrics" on a local port
+ * with the prometheus text format, so a prometheus server can scrape it.
+ *
+ * every thread that searches gets its own Worker and is the only one writing to it, so the threads never
+ * fight over a cache line. a search writes its numbers once it is over, from the SearchStats it counts anyway,
+ * so the search itself is not any slower. the server thread only reads.
+ * nodes per second and utilisation are counters, so prometheus can take the rate of them over any window it likes
+ */
+class Metrics
+{
+public:
+    Metrics();
+
+    // the numbers of one thread. only that thread writes them
+    struct alignas(64) Worker
+    {
+        std::atomic<bool> searching;
+        std::atomic<uint64_t> searches;
+        std::atomic<uint64_t> nodes;
+        std::atomic<uint64_t> busyMicroseconds; // time spent searching, so the rate of it is how busy the thread is
+        std::atomic<uint64_t> jobs; // queued jobs this thread finished
+        std::atomic<uint64_t> deadlinesMissed; // finished jobs that were late
+
+        // transposition table probes and hits over every search, and how full the table was at the end of the last one
+        std::atomic<uint64_t> tableProbes;
+        std::atomic<uint64_t> tableHits;
+        std::atomic<uint64_t> tableFilled;
+
+        // how many searches took at most METRICS_LATENCY_BUCKETS_MS[bucket], and were not in an earlier bucket.
+        // the last bucket is for the searches slower than all of them
+        std::atomic<uint64_t> latencyBuckets[METRICS_LATENCY_BUCKET_COUNT + 1];
+        std::atomic<uint64_t> latencyMicroseconds;
+
+        // count a finished search that took the given wall time
+        void addSearch(uint64_t searchNodes, uint64_t microseconds);
+    };
+
+    /*
+     * jobs given to the workers so far. whoever hands out the work adds to this, and the workers count the jobs they
+     * finish, so the queue depth is this minus the jobs the workers finished
+     */
+    std::atomic<uint64_t> queued;
+
+    // make a new worker. the server reads every worker, so add them all before calling serve()
+    Worker *addWorker();
+
+    // start answering on 127.0.0.1:port in the background. returns false if the port can't be used
+    bool serve(int port);
+
+private:
+    std::vector<Worker *> workers;
+
+    // the metrics in the prometheus text format
+    std::string getText();
+    void respond(int client);
+};
+
+
+#endif //UNTITLED2_METRICS_H
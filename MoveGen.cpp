@@ -12,13 +12,19 @@ MoveGen::MoveGen(Board *board)
 {
     this->board = board;
     this->position = &board->position;
+    // quiet moves are ordered by how they were generated until someone gives us a learned table
+    this->prior = nullptr;
+    this->pseudoLegal = PSEUDO_LEGAL_GENERATION;
+    this->flippedGeneration = FLIPPED_GENERATION;
 
+    // no checking pieces yet
+    nodeInfo.checkers = 0;
     // squares we can move a piece to in order to block or capture a checking piece
-    blockerSquares = FILLED_BOARD;
+    nodeInfo.blockerSquares = FILLED_BOARD;
     // squares along rank/file pins
-    cardinalPins = 0;
+    nodeInfo.cardinalPins = 0;
     // squares along diagonal pins
-    ordinalPins = 0;
+    nodeInfo.ordinalPins = 0;
 
     // go through each "magic square" on the board - spending a lot of time giving each square a calculated number
     // that perfectly hashes any blocker bitboard into it's corresponding attack bitboard. these magic numbers can
@@ -372,16 +378,32 @@ bool MoveGen::isKingInCheck(bool isEngine)
     }
 }
 
+void MoveGen::updateNodeInfo(bool isEngine)
+{
+    if (isEngine)
+    {
+        updateNodeInfo<true>();
+    }
+    else
+    {
+        updateNodeInfo<false>();
+    }
+}
+
 /*
  * all the code below is performance sensitive. it is what is running during the search.
  */
 void MoveGen::generateEngineMoves()
 {
-    getBlockerSquares<true>();
-    getCardinalPins<true>();
-    getOrdinalPins<true>();
+    updateNodeInfo<true>();
 
     generated.clear();
+    // if we are in check, only look for moves that get us out of check
+    if (nodeInfo.checkers)
+    {
+        generateEvasions<true>();
+        return;
+    }
     generatePawnMoves<true>();
     generateKnightMoves<true>();
     generateKingMoves<true>();
@@ -392,11 +414,23 @@ void MoveGen::generateEngineMoves()
 
 void MoveGen::generatePlayerMoves()
 {
-    getBlockerSquares<false>();
-    getCardinalPins<false>();
-    getOrdinalPins<false>();
+    if (flippedGeneration && !board->attackTracker)
+    {
+        board->flip();
+        generateEngineMoves();
+        board->flip();
+        unflipGenerated();
+        return;
+    }
+    updateNodeInfo<false>();
 
     generated.clear();
+    // if we are in check, only look for moves that get us out of check
+    if (nodeInfo.checkers)
+    {
+        generateEvasions<false>();
+        return;
+    }
     generatePawnMoves<false>();
     generateKnightMoves<false>();
     generateKingMoves<false>();
@@ -405,44 +439,161 @@ void MoveGen::generatePlayerMoves()
     generateQueenMoves<false>();
 }
 
+void MoveGen::generateEngineQuietChecks()
+{
+    updateNodeInfo<true>();
+
+    generated.clear();
+    // if we are in check, getting out of check is more important than giving one
+    if (!nodeInfo.checkers)
+    {
+        generateQuietChecks<true>();
+    }
+}
+
+void MoveGen::generatePlayerQuietChecks()
+{
+    if (flippedGeneration && !board->attackTracker)
+    {
+        board->flip();
+        generateEngineQuietChecks();
+        board->flip();
+        unflipGenerated();
+        return;
+    }
+    updateNodeInfo<false>();
+
+    generated.clear();
+    // if we are in check, getting out of check is more important than giving one
+    if (!nodeInfo.checkers)
+    {
+        generateQuietChecks<false>();
+    }
+}
+
+void MoveGen::unflipGenerated()
+{
+    // the engine's pieces on the flipped board are the player's pieces, and the other way around
+    for (Board::Move &move : generated)
+    {
+        move.from ^= 56;
+        move.to ^= 56;
+        move.moving = (PieceType)(move.moving - ENGINE_PAWN);
+        if (move.captured != NONE)
+        {
+            move.captured = (PieceType)(move.captured + ENGINE_PAWN);
+        }
+    }
+    nodeInfo.kingSquare ^= 56;
+    nodeInfo.checkers = flipVertical(nodeInfo.checkers);
+    nodeInfo.blockerSquares = flipVertical(nodeInfo.blockerSquares);
+    nodeInfo.cardinalPins = flipVertical(nodeInfo.cardinalPins);
+    nodeInfo.ordinalPins = flipVertical(nodeInfo.ordinalPins);
+}
+
+/*
+ * a pin test for pseudo legal moves. the king already makes sure it only steps on safe squares,
+ * and blockerSquares already makes sure we block or capture a checking piece. so the only way a generated move
+ * can be illegal is by moving a piece off the line between our king and an enemy slider.
+ *
+ * if the piece doesn't even start on a line from our king, it can't be pinned. otherwise, we scan outwards from the
+ * king with the piece moved and look for an enemy slider that is not the piece we are capturing
+ */
+bool MoveGen::isUnpinnedMove(Board::Move &move)
+{
+    bool isEngine = move.moving >= ENGINE_PAWN;
+    if (move.moving == (isEngine ? ENGINE_KING : PLAYER_KING))
+    {
+        return true;
+    }
+
+    uint8_t kingSquare = getLeastSquare(position->pieces[isEngine ? ENGINE_KING : PLAYER_KING]);
+    // en passant also removes the captured pawn, so it has to be tested even when the capturing pawn is off the lines
+    if (!LINE[kingSquare][move.from] && move.type != Board::EN_PASSANT)
+    {
+        return true;
+    }
+
+    // figure out the occupancy after the move is played. this is built from the position instead of
+    // board->occupiedSquares, because the search does not call update() when it unmakes a move
+    uint64_t occupied = 0;
+    for (uint64_t pieces : position->pieces)
+    {
+        occupied |= pieces;
+    }
+    occupied = (occupied ^ boardOf(move.from)) | boardOf(move.to);
+    uint64_t captured = boardOf(move.to);
+    if (move.type == Board::EN_PASSANT)
+    {
+        // the pawn captured en passant is not on the square we moved to
+        captured = position->enPassantCapture;
+        occupied ^= captured;
+    }
+
+    uint64_t cardinalBlockers = occupied & cardinals[kingSquare].blockers;
+    uint64_t ordinalBlockers = occupied & ordinals[kingSquare].blockers;
+
+    // enemy sliders that can see our king after the move, not counting the piece we captured
+    uint64_t attackers = cardinalAttacks[kingSquare][cardinalBlockers * cardinals[kingSquare].magic >> 52] &
+            (isEngine ? position->pieces[PLAYER_QUEEN] | position->pieces[PLAYER_ROOK]
+                      : position->pieces[ENGINE_QUEEN] | position->pieces[ENGINE_ROOK]);
+    attackers |= ordinalAttacks[kingSquare][ordinalBlockers * ordinals[kingSquare].magic >> 55] &
+            (isEngine ? position->pieces[PLAYER_QUEEN] | position->pieces[PLAYER_BISHOP]
+                      : position->pieces[ENGINE_QUEEN] | position->pieces[ENGINE_BISHOP]);
+
+    return !(attackers & ~captured);
+}
+
 // this is the function we call from the outside to get the generated moves.
 // it also sorts sort the moves from best to worst, in order to further prune the search tree
 // the moves go in this order: captures (winning), captures (losing), pawn moves
 std::vector<Board::Move> MoveGen::getSortedMoves()
 {
     std::vector<Board::Move> sorted;
+    std::vector<int> scores;
+    sorted.reserve(generated.size());
+    scores.reserve(generated.size());
+
+    int phase = prior ? MovePrior::getPhase(board->position) : 0;
 
-    while (!generated.empty())
+    for (Board::Move &move : generated)
     {
-        int score = 0;
-        int bestScore = -1;
-        int bestMoveIndex = 0;
+        // quiet piece moves go in between captures and pawn moves
+        int score = 1;
+        // captures first. PLAYER_PAWN is 0, so we have to compare against NONE here
+        if (move.captured != NONE)
+        {
+            // sort winning captures before losing captures (PxQ before QxP)
+            // quiet moves never score 512 or more, so every capture goes before them
+            score = 512 + PIECE_VALUES[ENGINE_QUEEN] + PIECE_VALUES[move.captured] - PIECE_VALUES[move.moving];
+        }
+        // pawn moves last
+        else if (move.moving == PLAYER_PAWN || move.moving == ENGINE_PAWN)
+        {
+            score = 0;
+        }
+        // quiet moves that were often played in real games go first.
+        // the old order only breaks ties between moves the table scores the same
+        if (prior && move.captured == NONE)
+        {
+            score += 2 * prior->getScore(phase, move);
+        }
 
-        for (int index = 0; index < generated.size(); index++)
+        // insert the move after every move that scored at least as much as it did,
+        // so moves that score the same stay in the order they were generated
+        int index = sorted.size();
+        sorted.push_back(move);
+        scores.push_back(score);
+        while (index > 0 && scores[index - 1] < score)
         {
-            Board::Move move = generated[index];
-            // captures first
-            if (move.captured)
-            {
-                // sort winning captures before losing captures (PxQ before QxP)
-                // this number will always be at least the value of a pawn
-                score = PIECE_VALUES[ENGINE_QUEEN] + PIECE_VALUES[move.captured] - PIECE_VALUES[move.moving];
-            }
-            // pawn moves last
-            else if (move.moving == PLAYER_PAWN || move.moving == ENGINE_PAWN)
-            {
-                score = 0;
-            }
-            if (score > bestScore)
-            {
-                bestScore = score;
-                bestMoveIndex = index;
-            }
+            sorted[index] = sorted[index - 1];
+            scores[index] = scores[index - 1];
+            index--;
         }
-        sorted.push_back(generated[bestMoveIndex]);
-        generated.erase(generated.begin() + bestMoveIndex);
+        sorted[index] = move;
+        scores[index] = score;
     }
-    std::reverse(sorted.begin(), sorted.end());
+    generated.clear();
     return sorted;
 }
 
@@ -460,7 +611,7 @@ inline void MoveGen::generateQueenMoves()
 
         uint64_t moves = 0;
         // if we are unpinned horizontal/vertical
-        if (queen & ~cardinalPins)
+        if (queen & ~nodeInfo.cardinalPins)
         {
             // generate ordinal sliding moves
             // figure out the pieces blocking the ordinal rays from the queen
@@ -469,14 +620,14 @@ inline void MoveGen::generateQueenMoves()
             moves |= ordinalAttacks[from][ordinalBlockers * ordinals[from].magic >> 55];
 
             // if we are pinned diagonally
-            if (queen & ordinalPins)
+            if (queen & nodeInfo.ordinalPins)
             {
                 // make sure we don't leave the diagonal pin
-                moves &= ordinalPins;
+                moves &= nodeInfo.ordinalPins;
             }
         }
         // if we are unpinned diagonally
-        if (queen & ~ordinalPins)
+        if (queen & ~nodeInfo.ordinalPins)
         {
             // generate cardinal sliding moves
             // figure out the pieces blocking the cardinal rays from the queen
@@ -485,16 +636,16 @@ inline void MoveGen::generateQueenMoves()
             moves |= cardinalAttacks[from][cardinalBlockers * cardinals[from].magic >> 52];
 
             // if we are pinned horizontal/vertical
-            if (queen & cardinalPins)
+            if (queen & nodeInfo.cardinalPins)
             {
                 // make sure we don't leave the horizontal/vertical pin
-                moves &= cardinalPins;
+                moves &= nodeInfo.cardinalPins;
             }
         }
         // make sure the queen doesn't capture her own pieces
         moves &= isEngine ? board->playerOrEmpty : board->engineOrEmpty;
         // make sure we don't leave our king in check
-        moves &= blockerSquares;
+        moves &= nodeInfo.blockerSquares;
 
         // look at each queen move
         while (moves)
@@ -517,7 +668,7 @@ inline void MoveGen::generateRookMoves()
     // rooks we want to generate sliding moves for - we don't have any moves if we are diagonally pinned
     uint64_t rooks = board->position.pieces[isEngine ? ENGINE_ROOK : PLAYER_ROOK];
     // don't generate moves for diagonally pinned rooks
-    rooks &= ~ordinalPins;
+    rooks &= ~nodeInfo.ordinalPins;
     while (rooks)
     {
         uint8_t from = popLeastSquare(rooks);
@@ -528,12 +679,12 @@ inline void MoveGen::generateRookMoves()
         // don't let us capture our own pieces
         moves &= (isEngine ? board->playerOrEmpty : board->engineOrEmpty);
         // make sure we don't leave our king in check
-        moves &= blockerSquares;
+        moves &= nodeInfo.blockerSquares;
         // make sure we dont break a horizontal/vertical pin
-        if (boardOf(from) & cardinalPins)
+        if (boardOf(from) & nodeInfo.cardinalPins)
         {
             // don't allow moves that are not on the line of the pin
-            moves &= cardinalPins;
+            moves &= nodeInfo.cardinalPins;
         }
         // look at each rook move
         while (moves)
@@ -557,7 +708,7 @@ inline void MoveGen::generateBishopMoves()
     // the bishops we are generating moves for
     uint64_t bishops = board->position.pieces[isEngine ? ENGINE_BISHOP : PLAYER_BISHOP];
     // don't generate moves for horizontal/vertical pinned bishops
-    bishops &= ~cardinalPins;
+    bishops &= ~nodeInfo.cardinalPins;
     while (bishops)
     {
         // look at each bishop
@@ -569,12 +720,12 @@ inline void MoveGen::generateBishopMoves()
         // make sure we don't capture our own pieces
         moves &= (isEngine ? board->playerOrEmpty : board->engineOrEmpty);
         // make sure we don't leave our king in check
-        moves &= blockerSquares;
+        moves &= nodeInfo.blockerSquares;
         // make sure we dont break a diagonal pin
-        if (boardOf(from) & ordinalPins)
+        if (boardOf(from) & nodeInfo.ordinalPins)
         {
             // don't allow moves that are not on the line of the pin
-            moves &= ordinalPins;
+            moves &= nodeInfo.ordinalPins;
         }
         // look at each bishop move
         while (moves)
@@ -597,14 +748,14 @@ inline void MoveGen::generateKnightMoves()
     // the knights we want to generate moves for.
     uint64_t knights = position->pieces[isEngine ? ENGINE_KNIGHT : PLAYER_KNIGHT];
     // don't generate moves for pinned knights
-    knights &= ~(cardinalPins | ordinalPins);
+    knights &= ~(nodeInfo.cardinalPins | nodeInfo.ordinalPins);
     while (knights)
     {
         uint8_t from = popLeastSquare(knights);
         // get the knight moves, and make sure we don't capture our own pieces
         uint64_t moves = KNIGHT_MOVES[from] & (isEngine ? board->playerOrEmpty : board->engineOrEmpty);
         // make sure we don't leave our king in check
-        moves &= blockerSquares;
+        moves &= nodeInfo.blockerSquares;
         while (moves)
         {
             // add each move with its possible capture
@@ -623,7 +774,7 @@ inline void MoveGen::generateKnightMoves()
 template<bool isEngine>
 inline void MoveGen::generateKingMoves()
 {
-    uint8_t from = getLeastSquare(board->position.pieces[isEngine ? ENGINE_KING : PLAYER_KING]);
+    uint8_t from = nodeInfo.kingSquare;
     // get the king's moves, and make sure it did not capture one of its own pieces
     uint64_t moves = KING_MOVES[from] & (isEngine ? board->playerOrEmpty : board->engineOrEmpty);
     // don't let the king walk onto attacked squares
@@ -637,71 +788,14 @@ inline void MoveGen::generateKingMoves()
         }
     }
 
-    // if we have not lost the right to castle queenside
-    if (isEngine ? position->engineCastleQueenside : position->playerCastleQueenside)
+    // castling only moves the king as far as the generated move goes. makeMove() brings the rook along
+    if (canCastle<isEngine>(false))
     {
-        // look at the entire path between rook and king
-        uint64_t path = isEngine ? ENGINE_QUEENSIDE_CASTLE : PLAYER_QUEENSIDE_CASTLE;
-        // take this "extra" square that is in between the destination square and rook into consideration.
-        // this only happens when we are castling queenside. we don't care about the check safety of the extra square
-        // because the square is not on the path the king takes
-        uint64_t extraSquare = isEngine ? ENGINE_QUEENSIDE_DESTINATION : PLAYER_QUEENSIDE_DESTINATION;
-        path |= ENGINE_IS_WHITE ? extraSquare << 1 : extraSquare >> 1;
-        // make sure there are three empty squares. if any of these squares have pieces on them,
-        // we cannot castle anyway so it is not worth it do square safety validation along the castling path
-        path &= board->emptySquares;
-        // if there are no pieces in the way
-        if (countSetBits(path) == 3)
-        {
-            // there are no pieces in the way of queenside castling.
-            // but let's also make sure we are not castling out of check, through check, or into check
-            path = isEngine ? ENGINE_QUEENSIDE_CASTLE : PLAYER_QUEENSIDE_CASTLE;
-            while (path)
-            {
-                // if we find an unsafe square along the path, we cannot castle
-                if (!isSafeSquare<isEngine>(popLeastSquare(path)))
-                {
-                    break;
-                }
-                // we looked at every square along the path and determined they are all safe to castle over
-                if (!path)
-                {
-                    // add the queenside castling move
-                    safeMoves |= isEngine ? ENGINE_QUEENSIDE_DESTINATION : PLAYER_QUEENSIDE_DESTINATION;
-                }
-            }
-        }
+        safeMoves |= isEngine ? ENGINE_QUEENSIDE_DESTINATION : PLAYER_QUEENSIDE_DESTINATION;
     }
-
-    // if we have not lost the right to castle kingside
-    if (isEngine ? position->engineCastleKingside : position->playerCastleKingside)
+    if (canCastle<isEngine>(true))
     {
-        // look at the entire path between rook and king
-        uint64_t path = isEngine ? ENGINE_KINGSIDE_CASTLE : PLAYER_KINGSIDE_CASTLE;
-        // make sure there are two empty squares. if these squares have pieces on them,
-        // we cannot castle anyway so it is not worth it to do check validation on the squares
-        path &= board->emptySquares;
-        if (countSetBits(path) == 2)
-        {
-            // there are no pieces in the way of castling.
-            // now let's make sure we are not castling out of check, through check, or into check
-            path = isEngine ? ENGINE_KINGSIDE_CASTLE : PLAYER_KINGSIDE_CASTLE;
-            // look through each square along the king's path
-            while (path)
-            {
-                // if a square is in check, we cannot castle, so stop looking
-                if (!isSafeSquare<isEngine>(popLeastSquare(path)))
-                {
-                    break;
-                }
-                // if we looked at every square along the path and determined they are all safe to castle over
-                if (!path)
-                {
-                    // add the kingside castling move
-                    safeMoves |= isEngine ? ENGINE_KINGSIDE_DESTINATION : PLAYER_KINGSIDE_DESTINATION;
-                }
-            }
-        }
+        safeMoves |= isEngine ? ENGINE_KINGSIDE_DESTINATION : PLAYER_KINGSIDE_DESTINATION;
     }
 
     while (safeMoves)
@@ -719,303 +813,770 @@ inline void MoveGen::generateKingMoves()
 
 
 template<bool isEngine>
-inline void MoveGen::generatePawnMoves()
+inline bool MoveGen::canCastle(bool isKingside)
 {
-    // the pawns we are generating moves for
-    uint64_t pawns = isEngine ? position->pieces[ENGINE_PAWN] : position->pieces[PLAYER_PAWN];
-    // push the pawn up one square if we can
-    // also, don't generate pawn pushes for diagonally pinned pawns
-    uint64_t singlePush = (isEngine ? (pawns & ~ordinalPins) << 8 : (pawns & ~ordinalPins) >> 8) & board->emptySquares;
-    // push the pawn up two squares, if it is a legal move
-    uint64_t doublePush = (isEngine ? (singlePush & RANK2) << 8 : (singlePush & RANK5) >> 8) & board->emptySquares;
-
-    // make sure we have to block the checking piece if we are in check
-    singlePush &= blockerSquares;
-    doublePush &= blockerSquares;
-
-    // go through each one square pawn move
-    while (singlePush)
+    // we can't castle out of check. so don't bother looking at the castling path if we are in check
+    if (nodeInfo.checkers)
     {
-        uint8_t to = popLeastSquare(singlePush);
-        uint8_t from = to + (isEngine ? -8 : 8);
+        return false;
+    }
+    if (isKingside ? !(isEngine ? position->engineCastleKingside : position->playerCastleKingside)
+                   : !(isEngine ? position->engineCastleQueenside : position->playerCastleQueenside))
+    {
+        return false;
+    }
 
-        uint64_t squareTo = boardOf(to);
+    // the rook is in the corner past the destination square. every square in between it and the king has to be empty.
+    // on the queenside this includes an "extra" square the king doesn't cross, so we don't care about the check safety of that one.
+    // if any of these squares have pieces on them, we cannot castle anyway
+    // so it is not worth it do square safety validation along the castling path
+    uint8_t king = nodeInfo.kingSquare;
+    uint8_t rook = isKingside == ENGINE_IS_WHITE ? king & 56 : king | 7;
+    if (BETWEEN[king][rook] & board->occupiedSquares)
+    {
+        return false;
+    }
 
-        // exclude push moves that should have been horizontal/vertical pinned
-        if ((boardOf(from) & cardinalPins) && !(squareTo & cardinalPins))
+    // there are no pieces in the way of castling.
+    // but let's also make sure we are not castling through check, or into check
+    uint64_t path = isKingside ? (isEngine ? ENGINE_KINGSIDE_CASTLE : PLAYER_KINGSIDE_CASTLE)
+                               : (isEngine ? ENGINE_QUEENSIDE_CASTLE : PLAYER_QUEENSIDE_CASTLE);
+    while (path)
+    {
+        // if we find an unsafe square along the path, we cannot castle
+        if (!isSafeSquare<isEngine>(popLeastSquare(path)))
         {
-            continue;
+            return false;
         }
+    }
+    return true;
+}
+
+template<bool isEngine>
+inline void MoveGen::generatePawnMoves()
+{
+    // the pawns we are generating moves for
+    uint64_t pawns = isEngine ? position->pieces[ENGINE_PAWN] : position->pieces[PLAYER_PAWN];
+
+    /*
+     * a pawn pinned along a file can still push, and a pawn pinned on a diagonal can still capture,
+     * as long as it lands on its pin. a pawn can't step from one line through our king onto another one,
+     * so the squares of every pin together are the mask for all the pinned pawns at once.
+     * a pawn pinned along a rank can't move at all, and a pawn pinned on a diagonal can't push
+     */
+    uint64_t unpinned = pawns & ~(nodeInfo.cardinalPins | nodeInfo.ordinalPins);
+    uint64_t cardinalPinned = pawns & nodeInfo.cardinalPins;
+    uint64_t ordinalPinned = pawns & nodeInfo.ordinalPins;
 
-        // if this pawn push is a promotion, generate all promotion types.
-        if (squareTo & (isEngine ? RANK7 : RANK0))
+    // move a whole bitboard of pawns one step. the captures make sure we don't shift over the edge
+    auto pushForward = [](uint64_t squares) { return isEngine ? squares << 8 : squares >> 8; };
+    auto captureLeft = [](uint64_t squares) { return isEngine ? (squares & ~FILE7) << 9 : (squares & ~FILE0) >> 9; };
+    auto captureRight = [](uint64_t squares) { return isEngine ? (squares & ~FILE0) << 7 : (squares & ~FILE7) >> 7; };
+
+    // add a move for every pawn that can promote on one of these squares, with every piece it can promote to
+    auto addPromotions = [&](uint64_t targets, int step, bool isCapture)
+    {
+        while (targets)
         {
+            uint8_t to = popLeastSquare(targets);
+            PieceType captured = !isCapture ? NONE : isEngine ? board->getPlayerPieceType(to) : board->getEnginePieceType(to);
             for (int promotionChoice = 0; promotionChoice < 4; promotionChoice++)
             {
                 generated.push_back(Board::Move{
                     (Board::MoveType)promotionChoice,
-                    from,
+                    (uint8_t)(to - step),
                     to,
                     isEngine ? ENGINE_PAWN : PLAYER_PAWN,
-                    NONE
+                    captured
                 });
             }
         }
-        // otherwise, just generate the pawn push move
-        else
+    };
+    // add a move for every pawn that can move to one of these squares. the pawns come from step squares behind them
+    auto addMoves = [&](uint64_t targets, int step, bool isCapture)
+    {
+        uint64_t promotions = targets & (isEngine ? RANK7 : RANK0);
+        targets ^= promotions;
+        // keep the moves in square order. the player promotes on the lowest squares and the engine on the highest
+        if (!isEngine)
+        {
+            addPromotions(promotions, step, isCapture);
+        }
+        while (targets)
         {
+            uint8_t to = popLeastSquare(targets);
             generated.push_back(Board::Move{
                 Board::NORMAL,
-                from,
+                (uint8_t)(to - step),
                 to,
                 isEngine ? ENGINE_PAWN : PLAYER_PAWN,
-                NONE
+                !isCapture ? NONE : isEngine ? board->getPlayerPieceType(to) : board->getEnginePieceType(to)
             });
         }
-    }
+        if (isEngine)
+        {
+            addPromotions(promotions, step, isCapture);
+        }
+    };
+
+    // push the pawns up one square if we can
+    uint64_t singlePush = (pushForward(unpinned) | (pushForward(cardinalPinned) & nodeInfo.cardinalPins)) & board->emptySquares;
+    // push them up two squares from where they started. a pawn that got through its first step stays on its pin
+    uint64_t doublePush = pushForward(singlePush & (isEngine ? RANK2 : RANK5)) & board->emptySquares;
+    // make sure we have to block the checking piece if we are in check
+    addMoves(singlePush & nodeInfo.blockerSquares, isEngine ? 8 : -8, false);
+    addMoves(doublePush & nodeInfo.blockerSquares, isEngine ? 16 : -16, false);
+
+    // only capture enemy pieces, and make sure we capture a checking piece if we are in check
+    uint64_t targets = (isEngine ? board->playerPieces : board->enginePieces) & nodeInfo.blockerSquares;
+    addMoves((captureLeft(unpinned) | (captureLeft(ordinalPinned) & nodeInfo.ordinalPins)) & targets, isEngine ? 9 : -9, true);
+    addMoves((captureRight(unpinned) | (captureRight(ordinalPinned) & nodeInfo.ordinalPins)) & targets, isEngine ? 7 : -7, true);
 
-    // go through each two square pawn move
-    while (doublePush)
+    // the en passant capture only gets us out of check if the pawn we capture is the checking piece
+    uint64_t captured = position->enPassantCapture & nodeInfo.blockerSquares;
+    if (captured)
     {
-        // figure out where we came from
-        uint8_t to = popLeastSquare(doublePush);
-        uint8_t from = to + (isEngine ? -16 : 16);
-        // exclude push moves that should have been horizontal/vertical pinned
-        if ((boardOf(from) & cardinalPins) && !(boardOf(to) & cardinalPins))
+        uint64_t rank = isEngine ? RANK4 : RANK3;
+        // our pawns on either side of the pawn we capture. a pawn pinned along a rank or file can't capture at all
+        uint64_t capturers = (captured << 1 | captured >> 1) & rank & (unpinned | ordinalPinned);
+        uint64_t destination = pushForward(captured);
+        // a diagonally pinned pawn can only capture along its pin
+        if (!(destination & nodeInfo.ordinalPins))
         {
-            continue;
+            capturers &= ~ordinalPinned;
+        }
+
+        /*
+         * we are going to need to do some special pin detection to make this work.
+         * this is because a pin is defined as the line between an attacking enemy piece and our king, with ONE of our
+         * pieces in between. in an en passant scenario, there can be TWO pieces in the line of a horizontal pin,
+         * because the captured en passant pawn and the capturing en passant pawn both disappear from the rank.
+         * if we have two pawns that can capture, the one that stays still blocks the rank, so only one capturer can
+         * be pinned this way. we look along the rank from our king with both pawns gone, once for the whole node
+         */
+        uint64_t king = position->pieces[isEngine ? ENGINE_KING : PLAYER_KING];
+        if ((king & rank) && countSetBits(capturers) == 1)
+        {
+            uint8_t kingSquare = getLeastSquare(king);
+            uint64_t blockers = cardinals[kingSquare].blockers & board->occupiedSquares & ~(captured | capturers);
+            uint64_t pin = cardinalAttacks[kingSquare][blockers * cardinals[kingSquare].magic >> 52] & rank;
+            if (pin & (position->pieces[isEngine ? PLAYER_QUEEN : ENGINE_QUEEN] | position->pieces[isEngine ? PLAYER_ROOK : ENGINE_ROOK]))
+            {
+                capturers = 0;
+            }
+        }
+
+        // the capture from the right side of the pawn goes first
+        uint8_t to = getLeastSquare(destination);
+        uint64_t right = capturers & (isEngine ? captured << 1 : captured >> 1);
+        for (uint64_t capturer : {right, capturers ^ right})
+        {
+            if (capturer)
+            {
+                generated.push_back(Board::Move{
+                        Board::EN_PASSANT,
+                        getLeastSquare(capturer),
+                        to,
+                        isEngine ? ENGINE_PAWN : PLAYER_PAWN,
+                        isEngine ? PLAYER_PAWN : ENGINE_PAWN
+                });
+            }
         }
-        // add the pawn move
-        generated.push_back(Board::Move{
-                Board::NORMAL,
-                from,
-                to,
-                isEngine ? ENGINE_PAWN : PLAYER_PAWN,
-                NONE
-        });
     }
+}
 
-    // now we want to generate all types of pawn captures.
-    // there is no case where a horizontal/vertical pinned pawn is able to capture.
-    // so get rid of horizontal/vertical pinned pawns right away
-    pawns &= ~cardinalPins;
+/*
+ * when we are in check, blockerSquares holds the checking piece and the squares in between it and our king.
+ * instead of generating every move and throwing most of them away, we go through those few squares and
+ * look backwards from each one to find the pieces that can move there. we can do this with the same
+ * lookups the move generators use, because knight and sliding moves are symmetrical
+ */
+template<bool isEngine>
+inline void MoveGen::generateEvasions()
+{
+    // the king can always try to step out of check
+    generateKingMoves<isEngine>();
 
-    // generate possible left captures. make sure we don't shift over the edge
-    uint64_t leftAttacks = isEngine ? (pawns & ~FILE7) << 9 : (pawns & ~FILE0) >> 9;
-    // only consider captures
-    leftAttacks &= isEngine ? board->playerPieces : board->enginePieces;
-    // make sure we have to capture a checking piece
-    leftAttacks &= blockerSquares;
-    // look at each of the left captures
-    while (leftAttacks)
+    // if we are in double check, moving the king is the only way out
+    if (!nodeInfo.blockerSquares)
     {
-        // figure out where we came from
-        uint8_t to = popLeastSquare(leftAttacks);
-        uint8_t from = to + (isEngine ? -9 : 9);
+        return;
+    }
 
+    // a pinned piece can never capture or block a checking piece, because it would have to leave its pin to do so
+    uint64_t unpinned = ~(nodeInfo.cardinalPins | nodeInfo.ordinalPins);
+    uint64_t pawns = position->pieces[isEngine ? ENGINE_PAWN : PLAYER_PAWN] & unpinned;
+    uint64_t knights = position->pieces[isEngine ? ENGINE_KNIGHT : PLAYER_KNIGHT] & unpinned;
+    uint64_t queens = position->pieces[isEngine ? ENGINE_QUEEN : PLAYER_QUEEN] & unpinned;
+    uint64_t cardinalSliders = (position->pieces[isEngine ? ENGINE_ROOK : PLAYER_ROOK] & unpinned) | queens;
+    uint64_t ordinalSliders = (position->pieces[isEngine ? ENGINE_BISHOP : PLAYER_BISHOP] & unpinned) | queens;
+
+    // look at the checking piece and each square in between it and our king
+    uint64_t targets = nodeInfo.blockerSquares;
+    while (targets)
+    {
+        uint8_t to = popLeastSquare(targets);
         uint64_t squareTo = boardOf(to);
-        uint64_t squareFrom = boardOf(from);
-
-        // exclude captures that should have been diagonally pinned
-        if (squareFrom & ordinalPins && !(squareTo & ordinalPins))
+        // this is NONE on the squares in between, and the checking piece on its own square
+        PieceType captured = isEngine ? board->getPlayerPieceType(to) : board->getEnginePieceType(to);
+
+        // look outwards from the target square to find the knights and sliders that can reach it
+        uint64_t cardinalBlockers = board->occupiedSquares & cardinals[to].blockers;
+        uint64_t ordinalBlockers = board->occupiedSquares & ordinals[to].blockers;
+        uint64_t movers = KNIGHT_MOVES[to] & knights;
+        movers |= cardinalAttacks[to][cardinalBlockers * cardinals[to].magic >> 52] & cardinalSliders;
+        movers |= ordinalAttacks[to][ordinalBlockers * ordinals[to].magic >> 55] & ordinalSliders;
+        while (movers)
         {
-            continue;
+            uint8_t from = popLeastSquare(movers);
+            generated.push_back(Board::Move{
+                Board::NORMAL,
+                from,
+                to,
+                isEngine ? board->getEnginePieceType(from) : board->getPlayerPieceType(from),
+                captured
+            });
         }
 
-        // if this pawn capture comes with a promotion
-        if (squareTo & (isEngine ? RANK7 : RANK0))
+        // figure out which pawns can reach the target square.
+        // pawns capture the checking piece diagonally, and push forward onto the empty squares in between
+        uint64_t pawnMovers;
+        if (captured != NONE)
         {
-            // generate all possible promotion moves
-            for (int promotionChoice = 0; promotionChoice < 4; promotionChoice++)
+            pawnMovers = isEngine ? ((squareTo & ~FILE0) >> 9 | (squareTo & ~FILE7) >> 7)
+                                  : ((squareTo & ~FILE7) << 9 | (squareTo & ~FILE0) << 7);
+        }
+        else
+        {
+            pawnMovers = isEngine ? squareTo >> 8 : squareTo << 8;
+            // a pawn can push two squares to get in the way if the square in front of it is empty
+            if (!(pawnMovers & board->occupiedSquares) && (squareTo & (isEngine ? RANK3 : RANK4)))
+            {
+                pawnMovers |= isEngine ? squareTo >> 16 : squareTo << 16;
+            }
+        }
+        pawnMovers &= pawns;
+        while (pawnMovers)
+        {
+            uint8_t from = popLeastSquare(pawnMovers);
+            // if this pawn move is a promotion, generate all promotion types
+            if (squareTo & (isEngine ? RANK7 : RANK0))
+            {
+                for (int promotionChoice = 0; promotionChoice < 4; promotionChoice++)
+                {
+                    generated.push_back(Board::Move{
+                        (Board::MoveType)promotionChoice,
+                        from,
+                        to,
+                        isEngine ? ENGINE_PAWN : PLAYER_PAWN,
+                        captured
+                    });
+                }
+            }
+            else
             {
                 generated.push_back(Board::Move{
-                    (Board::MoveType)promotionChoice,
+                    Board::NORMAL,
                     from,
                     to,
                     isEngine ? ENGINE_PAWN : PLAYER_PAWN,
-                    isEngine ? board->getPlayerPieceType(to) : board->getEnginePieceType(to)
+                    captured
                 });
             }
         }
-        // if we are not promoting
-        else
+    }
+
+    // if the pawn that just pushed two squares is the checking piece, we can also capture it en passant.
+    // we never have to worry about the horizontal en passant pin here, because a pawn can't give check along a rank
+    if (position->enPassantCapture & nodeInfo.blockerSquares)
+    {
+        // our pawns to the left and right of the pawn we want to capture
+        uint64_t capturing = ((position->enPassantCapture << 1 & ~FILE0) | (position->enPassantCapture >> 1 & ~FILE7)) & pawns;
+        while (capturing)
         {
-            // just add the pawn capture
+            uint8_t from = popLeastSquare(capturing);
             generated.push_back(Board::Move{
-                    Board::NORMAL,
-                    from,
-                    to,
-                    isEngine ? ENGINE_PAWN : PLAYER_PAWN,
-                    isEngine ? board->getPlayerPieceType(to) : board->getEnginePieceType(to)
+                Board::EN_PASSANT,
+                from,
+                (uint8_t)(getLeastSquare(position->enPassantCapture) + (isEngine ? 8 : -8)),
+                isEngine ? ENGINE_PAWN : PLAYER_PAWN,
+                isEngine ? PLAYER_PAWN : ENGINE_PAWN
             });
         }
     }
-    // generate right attacks. make sure we don't shift over the edge
-    uint64_t rightAttacks = isEngine ? (pawns & ~FILE0) << 7 : (pawns & ~FILE7) >> 7;
-    // only consider captures
-    rightAttacks &= isEngine ? board->playerPieces : board->enginePieces;
-    // make sure we have to capture a checking piece
-    rightAttacks &= blockerSquares;
-    // look at each of the right captures
-    while (rightAttacks)
+}
+
+/*
+ * a quiet move gives check in one of two ways. either the piece lands on a square it attacks the enemy king from,
+ * or it gets out of the way of one of our own sliders that is aimed at the enemy king.
+ *
+ * for the first kind, we look outwards from the enemy king with each movement type. a piece of that type
+ * gives check from any of those squares. for the second kind, we scan through our own pieces from the enemy king,
+ * the same way we scan through our pieces from our own king to find pins. any piece with our slider behind it
+ * gives check by moving off that line
+ */
+template<bool isEngine>
+inline void MoveGen::updateCheckInfo()
+{
+    uint8_t enemyKing = getLeastSquare(position->pieces[isEngine ? PLAYER_KING : ENGINE_KING]);
+    uint64_t enemyKingBoard = boardOf(enemyKing);
+    uint64_t ourPieces = isEngine ? board->enginePieces : board->playerPieces;
+
+    // squares each piece type would give check from
+    uint64_t cardinalBlockers = board->occupiedSquares & cardinals[enemyKing].blockers;
+    uint64_t ordinalBlockers = board->occupiedSquares & ordinals[enemyKing].blockers;
+    uint64_t cardinalChecks = cardinalAttacks[enemyKing][cardinalBlockers * cardinals[enemyKing].magic >> 52];
+    uint64_t ordinalChecks = ordinalAttacks[enemyKing][ordinalBlockers * ordinals[enemyKing].magic >> 55];
+
+    checkInfo.enemyKing = enemyKing;
+    checkInfo.cardinalChecks = cardinalChecks;
+    checkInfo.ordinalChecks = ordinalChecks;
+    checkInfo.knightChecks = KNIGHT_MOVES[enemyKing];
+    checkInfo.pawnChecks = isEngine ? ((enemyKingBoard & ~FILE0) >> 9 | (enemyKingBoard & ~FILE7) >> 7)
+                                    : ((enemyKingBoard & ~FILE7) << 9 | (enemyKingBoard & ~FILE0) << 7);
+
+    // our pieces that are the only thing between one of our sliders and the enemy king
+    checkInfo.cardinalDiscoverers = 0;
+    checkInfo.ordinalDiscoverers = 0;
+
+    // look through our pieces on the rank and file of the enemy king, and see if our rooks or queens are behind them
+    uint64_t possibleDiscoverers = cardinalChecks & ourPieces;
+    uint64_t xray = cardinalAttacks[enemyKing][(cardinalBlockers & ~possibleDiscoverers) * cardinals[enemyKing].magic >> 52];
+    uint64_t sliders = xray & ~cardinalChecks & (position->pieces[isEngine ? ENGINE_ROOK : PLAYER_ROOK] |
+                                                 position->pieces[isEngine ? ENGINE_QUEEN : PLAYER_QUEEN]);
+    while (sliders)
     {
-        // figure out where we came from
-        uint8_t to = popLeastSquare(rightAttacks);
-        uint8_t from = to + (isEngine ? -7 : 7);
+        // our piece is the one in between the slider and the enemy king
+        checkInfo.cardinalDiscoverers |= BETWEEN[enemyKing][popLeastSquare(sliders)] & possibleDiscoverers;
+    }
 
-        uint64_t squareTo = boardOf(to);
-        uint64_t squareFrom = boardOf(from);
+    // do the same along the diagonals of the enemy king, looking for our bishops or queens
+    possibleDiscoverers = ordinalChecks & ourPieces;
+    xray = ordinalAttacks[enemyKing][(ordinalBlockers & ~possibleDiscoverers) * ordinals[enemyKing].magic >> 55];
+    sliders = xray & ~ordinalChecks & (position->pieces[isEngine ? ENGINE_BISHOP : PLAYER_BISHOP] |
+                                       position->pieces[isEngine ? ENGINE_QUEEN : PLAYER_QUEEN]);
+    while (sliders)
+    {
+        checkInfo.ordinalDiscoverers |= BETWEEN[enemyKing][popLeastSquare(sliders)] & possibleDiscoverers;
+    }
+}
 
-        // exclude captures that should have been diagonally pinned
-        if (squareFrom & ordinalPins && !(squareTo & ordinalPins))
-        {
-            continue;
-        }
-        // if this capture comes with a promotion
-        if (squareTo & (isEngine ? RANK7 : RANK0))
+template<bool isEngine>
+inline void MoveGen::generateQuietChecks()
+{
+    updateCheckInfo<isEngine>();
+    uint8_t enemyKing = checkInfo.enemyKing;
+    uint64_t cardinalChecks = checkInfo.cardinalChecks;
+    uint64_t ordinalChecks = checkInfo.ordinalChecks;
+    uint64_t knightChecks = checkInfo.knightChecks;
+    uint64_t pawnChecks = checkInfo.pawnChecks;
+    uint64_t cardinalDiscoverers = checkInfo.cardinalDiscoverers;
+    uint64_t ordinalDiscoverers = checkInfo.ordinalDiscoverers;
+
+    // go through each of our piece types except pawns and the king, and find the quiet moves that give check
+    for (int type = isEngine ? ENGINE_KNIGHT : PLAYER_KNIGHT; type <= (isEngine ? ENGINE_QUEEN : PLAYER_QUEEN); type++)
+    {
+        uint64_t pieces = position->pieces[type];
+        while (pieces)
         {
-            // generate every possible promotion choice as a capture
-            for (int promotionChoice = 0; promotionChoice < 4; promotionChoice++)
+            uint8_t from = popLeastSquare(pieces);
+            uint64_t squareFrom = boardOf(from);
+
+            // the quiet moves of this piece
+            uint64_t moves = 0;
+            uint64_t checks = 0;
+            if (type == (isEngine ? ENGINE_KNIGHT : PLAYER_KNIGHT))
+            {
+                // pinned knights can't move at all
+                if (squareFrom & (nodeInfo.cardinalPins | nodeInfo.ordinalPins))
+                {
+                    continue;
+                }
+                moves = KNIGHT_MOVES[from];
+                checks = knightChecks;
+            }
+            if (type == (isEngine ? ENGINE_BISHOP : PLAYER_BISHOP) || type == (isEngine ? ENGINE_QUEEN : PLAYER_QUEEN))
+            {
+                // a piece pinned horizontal/vertical can't move diagonally
+                if (!(squareFrom & nodeInfo.cardinalPins))
+                {
+                    uint64_t blockers = board->occupiedSquares & ordinals[from].blockers;
+                    uint64_t diagonal = ordinalAttacks[from][blockers * ordinals[from].magic >> 55];
+                    // make sure we don't leave a diagonal pin
+                    moves |= squareFrom & nodeInfo.ordinalPins ? diagonal & nodeInfo.ordinalPins : diagonal;
+                }
+                checks |= ordinalChecks;
+            }
+            if (type == (isEngine ? ENGINE_ROOK : PLAYER_ROOK) || type == (isEngine ? ENGINE_QUEEN : PLAYER_QUEEN))
+            {
+                // a piece pinned diagonally can't move horizontal/vertical
+                if (!(squareFrom & nodeInfo.ordinalPins))
+                {
+                    uint64_t blockers = board->occupiedSquares & cardinals[from].blockers;
+                    uint64_t straight = cardinalAttacks[from][blockers * cardinals[from].magic >> 52];
+                    // make sure we don't leave a horizontal/vertical pin
+                    moves |= squareFrom & nodeInfo.cardinalPins ? straight & nodeInfo.cardinalPins : straight;
+                }
+                checks |= cardinalChecks;
+            }
+            // only quiet moves
+            moves &= board->emptySquares;
+
+            // if this piece is in the way of one of our sliders, every move off the line gives a discovered check
+            if (squareFrom & (cardinalDiscoverers | ordinalDiscoverers))
+            {
+                checks |= ~LINE[enemyKing][from];
+            }
+            moves &= checks;
+
+            while (moves)
             {
                 generated.push_back(Board::Move{
-                        (Board::MoveType)promotionChoice,
-                        from,
-                        to,
-                        isEngine ? ENGINE_PAWN : PLAYER_PAWN,
-                        isEngine ? board->getPlayerPieceType(to) : board->getEnginePieceType(to)
+                    Board::NORMAL,
+                    from,
+                    popLeastSquare(moves),
+                    (PieceType)type,
+                    NONE
                 });
             }
         }
-        // if this capture was not a promotion
-        else
+    }
+
+    // pawn pushes. diagonally pinned pawns can't push, and promotions are not quiet moves
+    uint64_t pawns = position->pieces[isEngine ? ENGINE_PAWN : PLAYER_PAWN] & ~nodeInfo.ordinalPins;
+    uint64_t singlePush = (isEngine ? pawns << 8 : pawns >> 8) & board->emptySquares & ~(isEngine ? RANK7 : RANK0);
+    uint64_t doublePush = (isEngine ? (singlePush & RANK2) << 8 : (singlePush & RANK5) >> 8) & board->emptySquares;
+    for (int pushDistance = 8; pushDistance <= 16; pushDistance += 8)
+    {
+        uint64_t pushes = pushDistance == 8 ? singlePush : doublePush;
+        while (pushes)
         {
-            // just add the capture move
-            generated.push_back(Board::Move{
+            uint8_t to = popLeastSquare(pushes);
+            uint8_t from = isEngine ? to - pushDistance : to + pushDistance;
+            uint64_t squareFrom = boardOf(from);
+            uint64_t squareTo = boardOf(to);
+
+            // exclude push moves that should have been horizontal/vertical pinned
+            if ((squareFrom & nodeInfo.cardinalPins) && !(squareTo & nodeInfo.cardinalPins))
+            {
+                continue;
+            }
+
+            // a pawn push gives check if it attacks the king from its new square, or if it uncovers one of our sliders.
+            // a pawn can't uncover a slider on its own file by pushing, so only horizontal and diagonal discoverers count
+            bool discovers = (squareFrom & ordinalDiscoverers) ||
+                             ((squareFrom & cardinalDiscoverers) && from / 8 == enemyKing / 8);
+            if ((squareTo & pawnChecks) || discovers)
+            {
+                generated.push_back(Board::Move{
                     Board::NORMAL,
                     from,
                     to,
                     isEngine ? ENGINE_PAWN : PLAYER_PAWN,
-                    isEngine ? board->getPlayerPieceType(to) : board->getEnginePieceType(to)
+                    NONE
+                });
+            }
+        }
+    }
+
+    /*
+     * castling gives check when the rook sees the enemy king from its new square, next to where the king started.
+     * the king starts on the edge of the board, so the only line it could uncover is the rank,
+     * and the rook is the only one of our pieces that can be behind it there. so only the rook needs looking at,
+     * with the king and the rook already moved, because the king might have been in the rook's way
+     */
+    for (int side = 0; side < 2; side++)
+    {
+        bool isKingside = side;
+        if (!canCastle<isEngine>(isKingside))
+        {
+            continue;
+        }
+        uint8_t from = nodeInfo.kingSquare;
+        uint8_t to = getLeastSquare(isKingside ? (isEngine ? ENGINE_KINGSIDE_DESTINATION : PLAYER_KINGSIDE_DESTINATION)
+                                               : (isEngine ? ENGINE_QUEENSIDE_DESTINATION : PLAYER_QUEENSIDE_DESTINATION));
+        uint8_t rookFrom = isKingside == ENGINE_IS_WHITE ? from & 56 : from | 7;
+        uint8_t rookTo = (from + to) / 2;
+        uint64_t occupied = board->occupiedSquares ^ boardOf(from) ^ boardOf(to) ^ boardOf(rookFrom) ^ boardOf(rookTo);
+        if (getAttacks(isEngine ? ENGINE_ROOK : PLAYER_ROOK, rookTo, occupied) & boardOf(enemyKing))
+        {
+            generated.push_back(Board::Move{
+                Board::NORMAL,
+                from,
+                to,
+                isEngine ? ENGINE_KING : PLAYER_KING,
+                NONE
+            });
+        }
+    }
+
+    // the king can only give a discovered check, and it has to step onto a safe square off the line to do it
+    uint8_t king = getLeastSquare(position->pieces[isEngine ? ENGINE_KING : PLAYER_KING]);
+    uint64_t kingMoves = 0;
+    if (boardOf(king) & (cardinalDiscoverers | ordinalDiscoverers))
+    {
+        kingMoves = KING_MOVES[king] & ~LINE[enemyKing][king];
+    }
+    kingMoves &= board->emptySquares;
+    while (kingMoves)
+    {
+        uint8_t to = popLeastSquare(kingMoves);
+        if (isSafeSquare<isEngine>(to))
+        {
+            generated.push_back(Board::Move{
+                Board::NORMAL,
+                king,
+                to,
+                isEngine ? ENGINE_KING : PLAYER_KING,
+                NONE
             });
         }
     }
+}
 
-    // if we should try to generate en passant capture moves.
-    if (position->enPassantCapture)
+bool MoveGen::mightGiveCheck(Board::Move &move)
+{
+    // these move a second piece or take away a piece that isn't on the destination square
+    if (move.type != Board::NORMAL)
     {
-        // first, restrict the pawns to the correct rank
-        pawns &= isEngine ? RANK4 : RANK3;
+        return true;
+    }
 
-        // figure out the en passant capture square. get rid of en passant captures that leave the king in check
-        uint64_t rightEnPassant = position->enPassantCapture & (isEngine ? pawns >> 1 : pawns << 1) & blockerSquares;
-        uint64_t leftEnPassant = position->enPassantCapture & (isEngine ? pawns << 1 : pawns >> 1) & blockerSquares;
+    uint64_t squareFrom = boardOf(move.from);
+    uint64_t squareTo = boardOf(move.to);
 
-        // we are going to need to do some special pin detection to make this work.
-        // this is because a pin is defined as the line between an attacking enemy piece and our king, with ONE of our pieces in between.
-        // in an en passant scenario, there can be TWO pieces in the line of a horizontal pin, because the captured en passant pawn
-        // and the capturing en passant pawn both disappear from the rank when the move is played
-        // because of this, this type of horizontal en passant pin is not picked up by the pin generation
+    // moving off the line between one of our sliders and the enemy king
+    if ((squareFrom & (checkInfo.cardinalDiscoverers | checkInfo.ordinalDiscoverers)) &&
+        !(squareTo & LINE[checkInfo.enemyKing][move.from]))
+    {
+        return true;
+    }
 
-        // if there is a right en passant capture
-        if (rightEnPassant)
-        {
-            // generate the right en passant capture
-            uint8_t from = getLeastSquare(isEngine ? rightEnPassant << 1 : rightEnPassant >> 1);
-            uint8_t to = from + (isEngine ? 7 : -7);
+    switch (move.moving)
+    {
+        case PLAYER_PAWN:
+        case ENGINE_PAWN:
+            return squareTo & checkInfo.pawnChecks;
+        case PLAYER_KNIGHT:
+        case ENGINE_KNIGHT:
+            return squareTo & checkInfo.knightChecks;
+        case PLAYER_BISHOP:
+        case ENGINE_BISHOP:
+            return squareTo & checkInfo.ordinalChecks;
+        case PLAYER_ROOK:
+        case ENGINE_ROOK:
+            return squareTo & checkInfo.cardinalChecks;
+        case PLAYER_QUEEN:
+        case ENGINE_QUEEN:
+            return squareTo & (checkInfo.cardinalChecks | checkInfo.ordinalChecks);
+        default:
+            // the king can't give check itself, but the rook can when we castle
+            return abs(move.from % 8 - move.to % 8) > 1;
+    }
+}
+
+bool MoveGen::canMateInOne(bool isEngine, std::vector<Board::Move> &moves)
+{
+    return isEngine ? canMateInOne<true>(moves) : canMateInOne<false>(moves);
+}
 
-            uint64_t blockers = cardinals[from].blockers & board->occupiedSquares & ~(position->enPassantCapture);
-            // get the horizontal attacks from the pawn we are capturing with
-            uint64_t pin = cardinalAttacks[from][blockers * cardinals[from].magic >> 52] & (isEngine ? RANK4 : RANK3);
-            pin &= position->pieces[isEngine ? ENGINE_KING : PLAYER_KING] | // look for our own king along the attack
-                   position->pieces[isEngine ? PLAYER_QUEEN : ENGINE_QUEEN] |  // look for enemy queens
-                   position->pieces[isEngine ? PLAYER_ROOK : ENGINE_ROOK]; // look for enemy rooks
+template<bool isEngine>
+inline bool MoveGen::canMateInOne(std::vector<Board::Move> &moves)
+{
+    updateCheckInfo<isEngine>();
+    // making moves changes the extra bitboards, so remember the occupancy before we start
+    uint64_t occupied = board->occupiedSquares;
 
+    /*
+     * the squares next to the enemy king it could step to right now. a mating move has to take every one of them away,
+     * and the only new squares a move can attack are the ones the moving piece attacks from where it lands, or squares
+     * one of our sliders sees through the square the piece left. so most checks can be thrown out without making them.
+     * we only figure these out once we know there is a check to try
+     */
+    uint64_t escapes = 0;
+    bool knowEscapes = false;
 
-            if ((boardOf(from) & ordinalPins) && !(boardOf(to) & ordinalPins))
-            {
-                // we can't add this en passant capture. moving the pawn in this way breaks a diagonal pin
-            }
-            // if we are not horizontally pinned
-            else if (countSetBits(pin) != 2)
+    Board::Position clone = board->position;
+    bool isMate = false;
+    bool madeMove = false;
+    for (Board::Move &move : moves)
+    {
+        // only a move that gives check can be checkmate
+        if (!mightGiveCheck(move) || !isLegalMove(move))
+        {
+            continue;
+        }
+
+        if (!knowEscapes)
+        {
+            uint64_t squares = KING_MOVES[checkInfo.enemyKing] & (isEngine ? board->engineOrEmpty : board->playerOrEmpty);
+            while (squares)
             {
-                // add the right en passant capture
-                generated.push_back(Board::Move{
-                        Board::EN_PASSANT,
-                        from,
-                        to,
-                        isEngine ? ENGINE_PAWN : PLAYER_PAWN,
-                        isEngine ? PLAYER_PAWN : ENGINE_PAWN
-                });
+                uint8_t square = popLeastSquare(squares);
+                if (isSafeSquare<!isEngine>(square))
+                {
+                    escapes |= boardOf(square);
+                }
             }
+            knowEscapes = true;
         }
-        // if there is a left en passant capture
-        if (leftEnPassant)
+        if (escapes & ~getNewAttacks<isEngine>(move, occupied))
+        {
+            continue;
+        }
+
+        board->makeMove<isEngine>(move);
+        madeMove = true;
+        isMate = isCheckmated<!isEngine>();
+
+        // unmake the move
+        board->restore(clone);
+        if (isMate)
         {
-            // generate the left en passant capture
-            uint8_t from = getLeastSquare(isEngine ? leftEnPassant >> 1 : leftEnPassant << 1);
-            uint8_t to = from + (isEngine ? 9 : -9);
+            break;
+        }
+    }
+    // unmaking a move doesn't put the extra bitboards back
+    if (madeMove)
+    {
+        board->update();
+    }
+    return isMate;
+}
+
+template<bool isEngine>
+inline uint64_t MoveGen::getNewAttacks(Board::Move &move, uint64_t occupied)
+{
+    // these move more than one piece, so anything could happen
+    if (move.type != Board::NORMAL)
+    {
+        return FILLED_BOARD;
+    }
 
-            uint64_t blockers = cardinals[from].blockers & board->occupiedSquares & ~(position->enPassantCapture);
-            // get the horizontal attacks from the pawn we are capturing with
-            uint64_t pin = cardinalAttacks[from][blockers * cardinals[from].magic >> 52] & (isEngine ? RANK4 : RANK3);
-            pin &= position->pieces[isEngine ? ENGINE_KING : PLAYER_KING] | // look for our own king along the attack
-                   position->pieces[isEngine ? PLAYER_QUEEN : ENGINE_QUEEN] |  // look for enemy queens
-                   position->pieces[isEngine ? PLAYER_ROOK : ENGINE_ROOK]; // look for enemy rooks
+    uint64_t squareTo = boardOf(move.to);
+    // the enemy king doesn't block the squares behind it
+    occupied = ((occupied ^ boardOf(move.from)) | squareTo) & ~boardOf(checkInfo.enemyKing);
 
-            if ((boardOf(from) & ordinalPins) && !(boardOf(to) & ordinalPins))
+    uint64_t attacks = 0;
+    switch (move.moving)
+    {
+        case PLAYER_PAWN:
+        case ENGINE_PAWN:
+            attacks = isEngine ? ((squareTo & ~FILE7) << 9 | (squareTo & ~FILE0) << 7)
+                               : ((squareTo & ~FILE0) >> 9 | (squareTo & ~FILE7) >> 7);
+            break;
+        case PLAYER_KNIGHT:
+        case ENGINE_KNIGHT:
+            attacks = KNIGHT_MOVES[move.to];
+            break;
+        case PLAYER_KING:
+        case ENGINE_KING:
+            attacks = KING_MOVES[move.to];
+            break;
+        default:
+            if (move.moving != (isEngine ? ENGINE_ROOK : PLAYER_ROOK))
             {
-                // we can't add this en passant capture. moving the pawn in this way breaks a diagonal pin
+                attacks |= ordinalAttacks[move.to][(occupied & ordinals[move.to].blockers) * ordinals[move.to].magic >> 55];
             }
-            // if we are not horizontally pinned
-            else if (countSetBits(pin) != 2)
+            if (move.moving != (isEngine ? ENGINE_BISHOP : PLAYER_BISHOP))
             {
-                // add the left en passant capture
-                generated.push_back(Board::Move{
-                        Board::EN_PASSANT,
-                        from,
-                        to,
-                        isEngine ? ENGINE_PAWN : PLAYER_PAWN,
-                        isEngine ? PLAYER_PAWN : ENGINE_PAWN
-                });
+                attacks |= cardinalAttacks[move.to][(occupied & cardinals[move.to].blockers) * cardinals[move.to].magic >> 52];
             }
-        }
+    }
+
+    // if one of our sliders could see the square we left, it might see further now
+    uint64_t cardinalSliders = cardinalAttacks[move.from][(occupied & cardinals[move.from].blockers) * cardinals[move.from].magic >> 52] &
+            (position->pieces[isEngine ? ENGINE_ROOK : PLAYER_ROOK] | position->pieces[isEngine ? ENGINE_QUEEN : PLAYER_QUEEN]);
+    uint64_t ordinalSliders = ordinalAttacks[move.from][(occupied & ordinals[move.from].blockers) * ordinals[move.from].magic >> 55] &
+            (position->pieces[isEngine ? ENGINE_BISHOP : PLAYER_BISHOP] | position->pieces[isEngine ? ENGINE_QUEEN : PLAYER_QUEEN]);
+    if (cardinalSliders)
+    {
+        attacks |= cardinalAttacks[move.from][0];
+    }
+    if (ordinalSliders)
+    {
+        attacks |= ordinalAttacks[move.from][0];
+    }
+    return attacks;
+}
+
+template<bool isEngine>
+inline bool MoveGen::isCheckmated()
+{
+    updateNodeInfo<isEngine>();
+    if (!nodeInfo.checkers)
+    {
+        return false;
+    }
 
+    // stepping out of the way is the most common escape, and the cheapest to look for
+    uint64_t escapes = KING_MOVES[nodeInfo.kingSquare] & (isEngine ? board->playerOrEmpty : board->engineOrEmpty);
+    while (escapes)
+    {
+        if (isSafeSquare<isEngine>(popLeastSquare(escapes)))
+        {
+            return false;
+        }
+    }
+    // nothing can block or capture two checkers at once
+    if (nodeInfo.checkers & (nodeInfo.checkers - 1))
+    {
+        return true;
     }
 
+    // look for a piece that can capture the checker or block the check
+    generated.clear();
+    generateEvasions<isEngine>();
+    for (Board::Move &move : generated)
+    {
+        if (isLegalMove(move))
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
 /*
- * populate the blockerSquares bitboard with squares on the board we could move to in order to
- * block an opponent's check or capture the checking piece. if there are no checkers, all squares are set to 1.
- * if there are multiple checkers, all squares are set to 0 because no piece can block a double check
+ * work out the checking pieces, blocker squares and pin rays for the side to move.
+ *
+ * my general strategy for this is to start at the king's square, and search outward in both sliding movement types.
+ * we can logical AND the resulting rays with enemy pieces and get a bitboard of the pieces putting the king in check.
+ * if there is only one checker, we logical AND the piece's attack bitboard with the king's rays to get the
+ * squares we could block the piece giving check to our king. then we logical OR the resulting board with the attacking piece
+ * to get the final set of squares we can move to in order to capture or block the checking piece.
  *
- * my general strategy for this is to start at the king's square, and search outward in all movement types
- * we can logical AND the resulting board with enemy pieces and get a bitboard of the pieces putting the king in check.
- * if there is only one checker, we logical AND the piece's attack bitboard with the king's scan bitboard to get the
- * squares we could  block the piece giving check to our king. then we logical OR the resulting board with the attacking piece
- * board to get the final set of squares we can move to in order to capture or block the checking piece
+ * a pin is the attack ray from the king to the pinning piece. we find those by removing our own pieces that the king's
+ * rays ran into from the blockers, and looking again. this lets us scan "through" the possibly pinned pieces,
+ * looking for the pinning pieces that may or may not exist.
  *
+ * the rays from the king are looked up once per movement type, and every bitboard above is derived from them
  */
 template<bool isEngine>
-inline void MoveGen::getBlockerSquares()
+inline void MoveGen::updateNodeInfo()
 {
-    uint64_t king = isEngine ? position->pieces[ENGINE_KING] : position->pieces[PLAYER_KING];
+    uint64_t king = position->pieces[isEngine ? ENGINE_KING : PLAYER_KING];
     uint8_t kingSquare = getLeastSquare(king);
+    nodeInfo.kingSquare = kingSquare;
+
+    // the enemy pieces that attack along each movement type
+    uint64_t cardinalEnemies = isEngine ? position->pieces[PLAYER_QUEEN] | position->pieces[PLAYER_ROOK]
+                                        : position->pieces[ENGINE_QUEEN] | position->pieces[ENGINE_ROOK];
+    uint64_t ordinalEnemies = isEngine ? position->pieces[PLAYER_QUEEN] | position->pieces[PLAYER_BISHOP]
+                                       : position->pieces[ENGINE_QUEEN] | position->pieces[ENGINE_BISHOP];
 
     // figure out the occupancies of both movement types for the king's square
     uint64_t cardinalBlockers = board->occupiedSquares & cardinals[kingSquare].blockers;
     uint64_t ordinalBlockers = board->occupiedSquares & ordinals[kingSquare].blockers;
 
-    // lookup the sliding movement attack rays from the king
-    uint64_t cardinalAttackRays = cardinalAttacks[kingSquare][cardinalBlockers * cardinals[kingSquare].magic >> 52];
-    uint64_t ordinalAttackRays = ordinalAttacks[kingSquare][ordinalBlockers * ordinals[kingSquare].magic >> 55];
+    // lookup the sliding movement attack rays from the king. these are the only lookups from the king's square
+    uint64_t cardinalRays = cardinalAttacks[kingSquare][cardinalBlockers * cardinals[kingSquare].magic >> 52];
+    uint64_t ordinalRays = ordinalAttacks[kingSquare][ordinalBlockers * ordinals[kingSquare].magic >> 55];
 
     // bitboard of enemy rooks or queens attacking our king
-    uint64_t cardinalAttackers = cardinalAttackRays & (isEngine ? position->pieces[PLAYER_QUEEN] | position->pieces[PLAYER_ROOK]
-                                                                : position->pieces[ENGINE_QUEEN] | position->pieces[ENGINE_ROOK]);
+    uint64_t cardinalAttackers = cardinalRays & cardinalEnemies;
     // bitboard of the enemy bishops or queens attacking our king
-    uint64_t ordinalAttackers = ordinalAttackRays & (isEngine ? position->pieces[PLAYER_QUEEN] | position->pieces[PLAYER_BISHOP]
-                                                              : position->pieces[ENGINE_QUEEN] | position->pieces[ENGINE_BISHOP]);
+    uint64_t ordinalAttackers = ordinalRays & ordinalEnemies;
     // bitboard of the sliding pieces attacking our king
     uint64_t attackers = cardinalAttackers | ordinalAttackers;
     // add possible enemy knights attacking our king
@@ -1024,43 +1585,20 @@ inline void MoveGen::getBlockerSquares()
     attackers |= (isEngine ? (king & ~FILE7) << 9 & position->pieces[PLAYER_PAWN] : (king & ~FILE0) >> 9 & position->pieces[ENGINE_PAWN]);
     // add possible right pawn attacks
     attackers |= (isEngine ? (king & ~FILE0) << 7 & position->pieces[PLAYER_PAWN] : (king & ~FILE7) >> 7 & position->pieces[ENGINE_PAWN]);
+    nodeInfo.checkers = attackers;
 
     // if our king is not in check
     if (!attackers)
     {
         // every square successfully stops check because we are not in check
-        blockerSquares = FILLED_BOARD;
+        nodeInfo.blockerSquares = FILLED_BOARD;
     }
     // if the king is checked by a single piece
     else if (countSetBits(attackers) == 1)
     {
-        uint8_t attacker;
-        // if the checking piece gives a cardinal attack ray
-        if (cardinalAttackers)
-        {
-            attacker = getLeastSquare(cardinalAttackers);
-            cardinalBlockers = board->occupiedSquares & cardinals[attacker].blockers;
-            // figure out which squares would stop the king from being put in check
-            cardinalAttackRays &= cardinalAttacks[attacker][cardinalBlockers * cardinals[attacker].magic >> 52];
-            // add on the capture of the attacking piece and remember these squares
-            blockerSquares = cardinalAttackRays | attackers;
-        }
-        // if the checking piece gives an ordinal attack ray
-        else if (ordinalAttackers)
-        {
-            attacker = getLeastSquare(ordinalAttackers);
-            ordinalBlockers = board->occupiedSquares & ordinals[attacker].blockers;
-            // figure out which squares would stop the king from being put in check
-            ordinalAttackRays &= ordinalAttacks[attacker][ordinalBlockers * ordinals[attacker].magic >> 55];
-            // add on the capture of the attacking piece and remember these squares
-            blockerSquares = ordinalAttackRays | attackers;
-        }
-        else
-        {
-            // if the checking piece is not a sliding piece, the only way to block
-            // or capture the check is by capturing the checking piece.
-            blockerSquares = attackers;
-        }
+        // the squares that would stop the check are the ones in between the checking piece and our king,
+        // and the capture of the checking piece. a knight or a pawn has nothing in between, so it can only be captured
+        nodeInfo.blockerSquares = BETWEEN[kingSquare][getLeastSquare(attackers)] | attackers;
     }
     // if the king is checked by multiple pieces
     else
@@ -1068,100 +1606,44 @@ inline void MoveGen::getBlockerSquares()
         // in the case of double check, there are no squares that are legal for blocks or captures
         // this is because you cannot block double check or capture two pieces at once.
         // you have to move the king, otherwise it is checkmate
-        blockerSquares = 0;
+        nodeInfo.blockerSquares = 0;
     }
-}
 
-/*
- * a function that updates the ordinalPins bitboard.
- *
- * a pin on the ordinalPins board (there may be multiple) is the attack ray from the king to
- * the pinning piece. we can generate this attack ray more easily by removing the pinned piece
- * from the occupied bitboard before hashing it to index the ordinal moves
- */
-template<bool isEngine>
-inline void MoveGen::getOrdinalPins()
-{
-    ordinalPins = 0;
+    nodeInfo.cardinalPins = 0;
+    nodeInfo.ordinalPins = 0;
+    // pins are checked later by isLegalMove() in pseudo legal mode
+    if (pseudoLegal)
+    {
+        return;
+    }
 
-    uint8_t king = getLeastSquare(position->pieces[isEngine ? ENGINE_KING : PLAYER_KING]);
+    uint64_t ourPieces = isEngine ? board->enginePieces : board->playerPieces;
 
-    // blockers along the ordinal rays of the king to hash into ordinal attack index
-    uint64_t ordinalBlockers = board->occupiedSquares & ordinals[king].blockers;
-    // get the squares that could have a diagonally pinned piece on it
-    uint64_t possiblyPinned = ordinalAttacks[king][ordinalBlockers * ordinals[king].magic >> 55];
-    possiblyPinned &= (isEngine ? board->enginePieces : board->playerPieces);
-
-    // remove the supposedly pinned pieces from the blocker set
-    ordinalBlockers &= ~possiblyPinned;
-    // scan diagonally from the king again in all directions, but using the new blocker bitboard
-    // that excludes friendly pieces that have the potential to be pinned. this allows us to
-    // scan "through" the possibly pinned piece, looking for the pinning piece that may or may not exist
-    uint64_t pins = ordinalAttacks[king][ordinalBlockers * ordinals[king].magic >> 55];
-    // bitboard of the enemy pieces that are pinning the pinned pieces
+    // our pieces the king's cardinal rays ran into could be pinned horizontal/vertical
+    uint64_t possiblyPinned = cardinalRays & ourPieces;
+    // scan from the king again, but through the possibly pinned pieces
+    uint64_t pins = cardinalAttacks[kingSquare][(cardinalBlockers & ~possiblyPinned) * cardinals[kingSquare].magic >> 52];
     // because we found an enemy along the attack ray through the removed friendly piece,
-    // we know the piece we removed was actually pinned
-    uint64_t pinning = pins & (isEngine ? position->pieces[PLAYER_QUEEN] | position->pieces[PLAYER_BISHOP]
-                                  : position->pieces[ENGINE_QUEEN] | position->pieces[ENGINE_BISHOP]);
-    // go through each square that might have a diagonally pinning enemy piece
+    // we know the piece we removed was actually pinned. pieces already giving check are not pinning anything
+    uint64_t pinning = pins & ~cardinalRays & cardinalEnemies;
+    // go through each square with a horizontal/vertical pinning enemy piece
     while (pinning)
     {
         uint8_t pinningSquare = popLeastSquare(pinning);
-        // recalculate blocker bitboard before hashing movement of pinning piece. maybe verify that this is required later.
-        ordinalBlockers = board->occupiedSquares & ordinals[pinningSquare].blockers & ~possiblyPinned;
-        // generate all ordinal attack rays coming out of the pinning piece
-        uint64_t pin = ordinalAttacks[pinningSquare][ordinalBlockers * ordinals[pinningSquare].magic >> 55];
-        // add this pin to the ordinal pins bitboard
-        ordinalPins |= pins & pin;
+        // the pin is every square in between the king and the pinning piece, which includes our pinned piece.
         // don't forget to add the capturing move -- we can capture a pinning piece while pinned.
-        ordinalPins |= boardOf(pinningSquare);
+        nodeInfo.cardinalPins |= BETWEEN[kingSquare][pinningSquare] | boardOf(pinningSquare);
     }
-}
 
-/*
- * a function that updates the cardinalPins bitboard.
- *
- * a pin on the cardinalPins board (there may be multiple) is the attack ray from the king to
- * the pinning piece. we can generate this attack ray more easily by removing the pinned piece
- * from the occupied bitboard before hashing it to index the ordinal moves
- */
-template<bool isEngine>
-inline void MoveGen::getCardinalPins()
-{
-    cardinalPins = 0;
-
-    uint8_t king = getLeastSquare(position->pieces[isEngine ? ENGINE_KING : PLAYER_KING]);
-
-    // blockers along the cardinal rays of the king to hash into cardinal attack index
-    uint64_t cardinalBlockers = board->occupiedSquares & cardinals[king].blockers;
-    // get the squares that could have a horizontal/vertical pinned piece on it
-    uint64_t possiblyPinned = cardinalAttacks[king][cardinalBlockers * cardinals[king].magic >> 52];
-    possiblyPinned &= (isEngine ? board->enginePieces : board->playerPieces);
-
-    // remove the supposedly pinned pieces from the blocker set
-    cardinalBlockers &= ~possiblyPinned;
-    // scan diagonally from the king again in all directions, but using the new blocker bitboard
-    // that excludes friendly pieces that have the potential to be pinned. this allows us to
-    // scan "through" the possibly pinned piece, looking for the pinning piece that may or may not exist
-    uint64_t pins = cardinalAttacks[king][cardinalBlockers * cardinals[king].magic >> 52];
-    // bitboard of the enemy pieces that are pinning the pinned pieces
-    // because we found an enemy along the attack ray through the removed friendly piece,
-    // we know the piece we removed was actually pinned
-    uint64_t pinning = pins & (isEngine ? position->pieces[PLAYER_QUEEN] | position->pieces[PLAYER_ROOK]
-                                        : position->pieces[ENGINE_QUEEN] | position->pieces[ENGINE_ROOK]);
-
-    // go through each square that might have a diagonally pinning enemy piece
+    // do the same thing diagonally
+    possiblyPinned = ordinalRays & ourPieces;
+    pins = ordinalAttacks[kingSquare][(ordinalBlockers & ~possiblyPinned) * ordinals[kingSquare].magic >> 55];
+    pinning = pins & ~ordinalRays & ordinalEnemies;
+    // go through each square with a diagonally pinning enemy piece
     while (pinning)
     {
         uint8_t pinningSquare = popLeastSquare(pinning);
-        // recalculate blocker bitboard before hashing movement of pinning piece.
-        cardinalBlockers = board->occupiedSquares & cardinals[pinningSquare].blockers & ~possiblyPinned;
-        // generate all ordinal attack rays coming out of the pinning piece
-        uint64_t pin = cardinalAttacks[pinningSquare][cardinalBlockers * cardinals[pinningSquare].magic >> 52];
-        // add this pin to the ordinal pins bitboard
-        cardinalPins |= pins & pin;
-        // don't forget to add the capturing move -- we can capture a pinning piece while pinned.
-        cardinalPins |= boardOf(pinningSquare);
+        nodeInfo.ordinalPins |= BETWEEN[kingSquare][pinningSquare] | boardOf(pinningSquare);
     }
 }
 
@@ -1172,6 +1654,17 @@ inline void MoveGen::getCardinalPins()
 template<bool isEngine>
 inline bool MoveGen::isSafeSquare(uint8_t square)
 {
+    if (board->attackTracker)
+    {
+        uint64_t enemyPieces = isEngine ? board->playerPieces : board->enginePieces;
+        // if our king is in check, a slider might see through it to the square, and the tables can't tell us that.
+        // otherwise, the attackers of the square are already in the table
+        if (!(board->attacksTo[getLeastSquare(position->pieces[isEngine ? ENGINE_KING : PLAYER_KING])] & enemyPieces))
+        {
+            return !(board->attacksTo[square] & enemyPieces);
+        }
+    }
+
     uint64_t attacked = boardOf(square);
 
     // figure out the occupancies of both movement types for the desired square.
@@ -1206,3 +1699,118 @@ inline bool MoveGen::isSafeSquare(uint8_t square)
 
     return attackers == 0;
 }
+
+inline uint64_t MoveGen::getAttacks(int pieceType, uint8_t square, uint64_t occupied)
+{
+    uint64_t cardinalBlockers = occupied & cardinals[square].blockers;
+    uint64_t ordinalBlockers = occupied & ordinals[square].blockers;
+    switch (pieceType)
+    {
+        case PLAYER_PAWN:
+            return (boardOf(square) & ~FILE0) >> 9 | (boardOf(square) & ~FILE7) >> 7;
+        case ENGINE_PAWN:
+            return (boardOf(square) & ~FILE7) << 9 | (boardOf(square) & ~FILE0) << 7;
+        case PLAYER_KNIGHT:
+        case ENGINE_KNIGHT:
+            return KNIGHT_MOVES[square];
+        case PLAYER_KING:
+        case ENGINE_KING:
+            return KING_MOVES[square];
+        case PLAYER_BISHOP:
+        case ENGINE_BISHOP:
+            return ordinalAttacks[square][ordinalBlockers * ordinals[square].magic >> 55];
+        case PLAYER_ROOK:
+        case ENGINE_ROOK:
+            return cardinalAttacks[square][cardinalBlockers * cardinals[square].magic >> 52];
+        default:
+            return cardinalAttacks[square][cardinalBlockers * cardinals[square].magic >> 52] |
+                   ordinalAttacks[square][ordinalBlockers * ordinals[square].magic >> 55];
+    }
+}
+
+void MoveGen::trackAttacks(bool isTracking)
+{
+    if (!isTracking)
+    {
+        board->attackTracker = nullptr;
+        return;
+    }
+
+    board->update();
+    for (uint64_t &attackers : board->attacksTo)
+    {
+        attackers = 0;
+    }
+    for (uint8_t square = 0; square < 64; square++)
+    {
+        board->attacksFrom[square] = 0;
+        PieceType pieceType = board->getPieceType(square);
+        if (pieceType == NONE)
+        {
+            continue;
+        }
+        uint64_t attacks = getAttacks(pieceType, square, board->occupiedSquares);
+        board->attacksFrom[square] = attacks;
+        while (attacks)
+        {
+            board->attacksTo[popLeastSquare(attacks)] |= boardOf(square);
+        }
+    }
+    board->attackTracker = this;
+}
+
+void MoveGen::refreshAttacks(uint64_t changed)
+{
+    uint64_t *attacksFrom = board->attacksFrom;
+    uint64_t *attacksTo = board->attacksTo;
+    uint64_t sliders = position->pieces[PLAYER_BISHOP] | position->pieces[PLAYER_ROOK] | position->pieces[PLAYER_QUEEN] |
+                       position->pieces[ENGINE_BISHOP] | position->pieces[ENGINE_ROOK] | position->pieces[ENGINE_QUEEN];
+
+    /*
+     * a slider that didn't move only sees something different if a square on one of its rays changed.
+     * the closest changed square on that ray was attacked by the slider before the change, so the sliders
+     * we need are the ones that attacked a changed square
+     */
+    uint64_t lookers = 0;
+    uint64_t squares = changed;
+    while (squares)
+    {
+        uint8_t square = popLeastSquare(squares);
+        lookers |= attacksTo[square];
+
+        // the piece that was on this square is gone (or replaced), so take its attacks away
+        uint64_t attacks = attacksFrom[square];
+        while (attacks)
+        {
+            attacksTo[popLeastSquare(attacks)] &= ~boardOf(square);
+        }
+        attacksFrom[square] = 0;
+    }
+    lookers &= sliders & ~changed;
+
+    // only the squares a slider sees now but didn't see before (or the other way around) change
+    while (lookers)
+    {
+        uint8_t square = popLeastSquare(lookers);
+        uint64_t attacks = getAttacks(board->getPieceType(square), square, board->occupiedSquares);
+        uint64_t difference = attacks ^ attacksFrom[square];
+        attacksFrom[square] = attacks;
+        while (difference)
+        {
+            attacksTo[popLeastSquare(difference)] ^= boardOf(square);
+        }
+    }
+
+    // add the attacks of the pieces that are on the changed squares now
+    squares = changed & board->occupiedSquares;
+    while (squares)
+    {
+        uint8_t square = popLeastSquare(squares);
+        uint64_t attacks = getAttacks(board->getPieceType(square), square, board->occupiedSquares);
+        attacksFrom[square] = attacks;
+        while (attacks)
+        {
+            attacksTo[popLeastSquare(attacks)] |= boardOf(square);
+        }
+    }
+}
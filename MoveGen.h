@@ -6,6 +6,7 @@
 #define UNTITLED2_MOVEGEN_H
 
 #include "Evaluation.h"
+#include "MovePrior.h"
 
 class MoveGen
 {
@@ -14,32 +15,106 @@ public:
 
     Board *board;
 
+    // a learned table used to order quiet moves in getSortedMoves(). null if we don't have one
+    MovePrior *prior;
+
+    // ignore pins while generating, and leave them to isLegalMove(). starts as PSEUDO_LEGAL_GENERATION
+    bool pseudoLegal;
+
+    /*
+     * generate the player's moves with the engine's generator on a flipped board (see Board::flip()),
+     * then flip the moves and nodeInfo back. starts as FLIPPED_GENERATION.
+     * it is skipped while the attacks are tracked, because the attack tables can't be flipped cheaply
+     */
+    bool flippedGeneration;
+
     bool isKingInCheck(bool isEngine);
     void generateEngineMoves();
     void generatePlayerMoves();
     std::vector<Board::Move> getSortedMoves();
 
-private:
-    Board::Position *position;
+    // the generated moves in the exact order they were generated. this order never changes for a given position
+    inline std::vector<Board::Move> &getGeneratedMoves()
+    {
+        return generated;
+    }
 
     /*
-     * a bitboard showing the squares we can move a piece to, while considering the opponent's checks
-     * if our king is not in check at all, every square is "legal".
-     * if our king is in check, then this bitboard is the squares a piece can move to in order to block the check
-     * if there are more than 1 checkers, this bitboard is 0, because there is no way to block
-     * a double check. the king must step out of the way of the attackers, otherwise it is checkmate.
+     * generate only the moves that don't capture anything but still put the enemy king in check.
+     * the quiescence search uses these on its first ply, so it doesn't miss a quiet check that wins material.
+     * castling counts when the rook gives check from its new square. nothing is generated if our own king is in check
      */
-    uint64_t blockerSquares;
+    void generateEngineQuietChecks();
+    void generatePlayerQuietChecks();
 
     /*
-     * these bitboards represent the squares along the active pin rays in the position.
-     * there is one per pin ray type.
-     *
-     * we need to keep cardinal and ordinal pins seperated to avoid illegally moving a piece out
-     * of an absolute pin to block a different absolute pin produced by the opposite sliding movement type
+     * figure out if the side to move can checkmate in one move, without searching.
+     * moves are the moves we already generated for the side to move. only the ones that could give check are tried,
+     * and for each one we look at the enemy king's escape squares before looking for a way to capture or block
+     * the checking piece. the board is left how it was found, but the generated moves and the node info are not
+     */
+    bool canMateInOne(bool isEngine, std::vector<Board::Move> &moves);
+
+    /*
+     * start or stop keeping board->attacksFrom and board->attacksTo up to date. starting works the tables out from scratch.
+     * while they are tracked, the board has to be unmade with Board::restore(), and isSafeSquare() reads the tables
+     * instead of looking for attackers itself
      */
-    uint64_t cardinalPins;
-    uint64_t ordinalPins;
+    void trackAttacks(bool isTracking);
+    // work out the attacks again for the pieces on the changed squares and the sliders that looked through them
+    void refreshAttacks(uint64_t changed);
+
+    /*
+     * figure out if a generated move leaves our own king in check.
+     * with fully legal generation every generated move is legal, so this is always true.
+     * with pseudo legal generation, a pinned piece might have walked off its pin, so we have to
+     * look for a slider that would see our king once the move is played
+     */
+    inline bool isLegalMove(Board::Move &move)
+    {
+        return !pseudoLegal || isUnpinnedMove(move);
+    }
+
+    /*
+     * everything we know about the king of the side to move, worked out once per node by updateNodeInfo().
+     * the move generators use it to keep moves legal, and the search uses it to know if it is in check
+     */
+    struct NodeInfo
+    {
+        uint8_t kingSquare;
+
+        // the enemy pieces giving check to our king
+        uint64_t checkers;
+
+        /*
+         * a bitboard showing the squares we can move a piece to, while considering the opponent's checks
+         * if our king is not in check at all, every square is "legal".
+         * if our king is in check, then this bitboard is the squares a piece can move to in order to block the check
+         * if there are more than 1 checkers, this bitboard is 0, because there is no way to block
+         * a double check. the king must step out of the way of the attackers, otherwise it is checkmate.
+         */
+        uint64_t blockerSquares;
+
+        /*
+         * these bitboards represent the squares along the active pin rays in the position.
+         * there is one per pin ray type.
+         *
+         * we need to keep cardinal and ordinal pins seperated to avoid illegally moving a piece out
+         * of an absolute pin to block a different absolute pin produced by the opposite sliding movement type
+         */
+        uint64_t cardinalPins;
+        uint64_t ordinalPins;
+    } nodeInfo;
+
+    /*
+     * fill in nodeInfo for the engine or the player without generating any moves.
+     * the generate functions call this themselves, so this is only needed when we want to know
+     * about checks before deciding whether to generate moves at all
+     */
+    void updateNodeInfo(bool isEngine);
+
+private:
+    Board::Position *position;
 
     /*
      * a vector that gets populated with Move structs that are legal chess moves
@@ -55,6 +130,13 @@ private:
     template<bool isEngine>
     inline void generateKingMoves();
 
+    /*
+     * figure out if we can castle one way. we need the right to castle that way, the squares between
+     * the king and the rook have to be empty, and we can't castle out of check, through check, or into check
+     */
+    template<bool isEngine>
+    inline bool canCastle(bool isKingside);
+
     template<bool isEngine>
     inline void generateRookMoves();
 
@@ -65,17 +147,67 @@ private:
     inline void generateQueenMoves();
 
     /*
-     * update the squares that show where a checking piece must be captured or blocked.
-     * if there are no checking pieces, every square is a 1. if it is double check, every square is 0
+     * generate moves when our king is in check. this is used instead of the generators above.
+     * in double check, only the king can move. in single check, we only look for pieces that can
+     * capture the checking piece or step onto the squares in between it and our king
+     */
+    template<bool isEngine>
+    inline void generateEvasions();
+
+    template<bool isEngine>
+    inline void generateQuietChecks();
+
+    /*
+     * the squares each of our piece types would check the enemy king from, and our pieces that would
+     * give a discovered check by moving off the line between one of our sliders and the enemy king
+     */
+    struct CheckInfo
+    {
+        uint8_t enemyKing;
+        uint64_t cardinalChecks;
+        uint64_t ordinalChecks;
+        uint64_t knightChecks;
+        uint64_t pawnChecks;
+        uint64_t cardinalDiscoverers;
+        uint64_t ordinalDiscoverers;
+    } checkInfo;
+
+    template<bool isEngine>
+    inline void updateCheckInfo();
+
+    /*
+     * use checkInfo to tell if a move gives check. this never says no to a move that gives check,
+     * but promotions, en passant and castling are always a maybe, because they move more than one square around
+     */
+    bool mightGiveCheck(Board::Move &move);
+
+    template<bool isEngine>
+    inline bool canMateInOne(std::vector<Board::Move> &moves);
+
+    /*
+     * every square we might attack after the move that we did not attack before. occupied is the occupancy
+     * before the move. this can have too many squares, but it never leaves one out
      */
     template<bool isEngine>
-    inline void getBlockerSquares();
+    inline uint64_t getNewAttacks(Board::Move &move, uint64_t occupied);
 
+    // true if the side to move is in check and has no legal moves. overwrites the generated moves
     template<bool isEngine>
-    inline void getOrdinalPins();
+    inline bool isCheckmated();
 
+    /*
+     * find the checking pieces, the squares that stop a check and the pin rays, all from the same
+     * lookups from the king's square. if there are no checking pieces, every blocker square is a 1.
+     * if it is double check, every blocker square is 0
+     */
     template<bool isEngine>
-    inline void getCardinalPins();
+    inline void updateNodeInfo();
+
+    // flip the generated moves and nodeInfo back after generating on a flipped board
+    void unflipGenerated();
+
+    // the pin test behind isLegalMove() in pseudo legal mode
+    bool isUnpinnedMove(Board::Move &move);
 
     /*
     * a function that tells us whether a square is attacked by the opponent.
@@ -86,6 +218,9 @@ private:
     template<bool isEngine>
     inline bool isSafeSquare(uint8_t square);
 
+    // the squares a piece type attacks from a square, with the given occupancy
+    inline uint64_t getAttacks(int pieceType, uint8_t square, uint64_t occupied);
+
     /*
      * a struct used in my fixed shift plain magic bitboard implementation. a magic square
      * has information useful for hashing the collision occupancy for a sliding piece
@@ -0,0 +1,98 @@
+//
+// Created by Joe Chrisman on 5/24/22.
+//
+
+#include <fstream>
+#include <cstring>
+#include "MovePrior.h"
+#include "MoveGen.h"
+
+MovePrior::MovePrior()
+{
+    memset(table, 0, sizeof(table));
+}
+
+void MovePrior::learn(MoveGen *generator, std::vector<std::vector<Board::Move>> &games)
+{
+    const int entries = PRIOR_PHASES * 12 * 64 * 64;
+    // how often each move was played, and how often it could have been played
+    std::vector<uint32_t> played(entries, 0);
+    std::vector<uint32_t> possible(entries, 0);
+
+    Board *board = generator->board;
+    Board::Position saved = board->position;
+    bool savedEngineToMove = board->engineToMove;
+
+    for (std::vector<Board::Move> &game : games)
+    {
+        Board initial;
+        board->position = initial.position;
+        board->engineToMove = initial.engineToMove;
+        board->update();
+
+        for (Board::Move &move : game)
+        {
+            if (board->engineToMove)
+            {
+                generator->generateEngineMoves();
+            }
+            else
+            {
+                generator->generatePlayerMoves();
+            }
+
+            int phase = getPhase(board->position);
+            for (Board::Move &legal : generator->getGeneratedMoves())
+            {
+                // captures are already sorted well enough by what they capture
+                if (legal.captured == NONE && generator->isLegalMove(legal))
+                {
+                    possible[((phase * 12 + legal.moving) * 64 + legal.from) * 64 + legal.to]++;
+                }
+            }
+            if (move.captured == NONE)
+            {
+                played[((phase * 12 + move.moving) * 64 + move.from) * 64 + move.to]++;
+            }
+
+            if (board->engineToMove)
+            {
+                board->makeMove<true>(move);
+            }
+            else
+            {
+                board->makeMove<false>(move);
+            }
+        }
+    }
+
+    uint8_t *scores = &table[0][0][0][0];
+    for (int index = 0; index < entries; index++)
+    {
+        // moves that were only possible a few times are pulled towards 0, so one lucky game doesn't make a move look great
+        scores[index] = 255 * (uint64_t)played[index] / (possible[index] + PRIOR_SMOOTHING);
+    }
+
+    board->position = saved;
+    board->engineToMove = savedEngineToMove;
+    board->update();
+}
+
+bool MovePrior::save(const std::string &path)
+{
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char *)table, sizeof(table));
+    return file.good();
+}
+
+bool MovePrior::load(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    // a table with the wrong size was made for a different build, so don't use it
+    if (!file.read((char *)table, sizeof(table)) || file.peek() != EOF)
+    {
+        memset(table, 0, sizeof(table));
+        return false;
+    }
+    return true;
+}
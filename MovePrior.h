@@ -0,0 +1,58 @@
+//
+// Created by Joe Chrisman on 5/24/22.
+//
+
+#ifndef UNTITLED2_MOVEPRIOR_H
+#define UNTITLED2_MOVEPRIOR_H
+
+#include "Board.h"
+
+class MoveGen;
+
+/*
+ * a table that says how good a quiet move usually is, learned ahead of time from whole games.
+ * the search has no idea which quiet moves are good until it searches them, so without this table
+ * quiet moves are just searched in the order they were generated.
+ *
+ * for every piece, from square, to square and phase of the game, we count how often the move was played
+ * and how often it could have been played. a move that gets played almost every time it is possible scores close to 255,
+ * and a move that was never played scores 0. getSortedMoves() uses the score to order the quiet moves
+ */
+class MovePrior
+{
+public:
+    MovePrior();
+
+    // the phase of the game. 0 is the opening and middlegame, 1 is the endgame
+    static inline int getPhase(Board::Position &position)
+    {
+        uint64_t pieces = 0;
+        for (int type = PLAYER_KNIGHT; type < PLAYER_KING; type++)
+        {
+            pieces |= position.pieces[type] | position.pieces[type + ENGINE_PAWN];
+        }
+        return countSetBits(pieces) <= PRIOR_ENDGAME_PIECES;
+    }
+
+    inline uint8_t getScore(int phase, Board::Move &move)
+    {
+        return table[phase][move.moving][move.from][move.to];
+    }
+
+    /*
+     * replay every game from the initial position, and count the quiet moves that were played against the quiet
+     * moves that were legal in each position. the table is replaced with the result.
+     * the board the generator uses is left how it was found
+     */
+    void learn(MoveGen *generator, std::vector<std::vector<Board::Move>> &games);
+
+    // the table is saved as raw bytes
+    bool save(const std::string &path);
+    bool load(const std::string &path);
+
+private:
+    uint8_t table[PRIOR_PHASES][12][64][64];
+};
+
+
+#endif //UNTITLED2_MOVEPRIOR_H
@@ -0,0 +1,88 @@
+//
+// Created by Joe Chrisman on 6/2/22.
+//
+
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include "Network.h"
+
+Network::Network()
+{
+    memset(hiddenWeights, 0, sizeof(hiddenWeights));
+    memset(hiddenBiases, 0, sizeof(hiddenBiases));
+    memset(outputWeights, 0, sizeof(outputWeights));
+    outputBias = 0;
+}
+
+int Network::evaluate(Board::Position &position)
+{
+    int32_t hidden[NETWORK_HIDDEN];
+    for (int neuron = 0; neuron < NETWORK_HIDDEN; neuron++)
+    {
+        hidden[neuron] = hiddenBiases[neuron];
+    }
+
+    // add up the weights of every piece on the board
+    for (int pieceType = PLAYER_PAWN; pieceType < NONE; pieceType++)
+    {
+        uint64_t pieces = position.pieces[pieceType];
+        while (pieces)
+        {
+            int16_t *weights = hiddenWeights[getInput(pieceType, popLeastSquare(pieces))];
+            for (int neuron = 0; neuron < NETWORK_HIDDEN; neuron++)
+            {
+                hidden[neuron] += weights[neuron];
+            }
+        }
+    }
+
+    int64_t output = outputBias;
+    for (int neuron = 0; neuron < NETWORK_HIDDEN; neuron++)
+    {
+        // clip the neuron between 0 and 1, which is 0 and NETWORK_HIDDEN_SCALE here
+        int32_t activation = std::min(std::max(hidden[neuron], 0), NETWORK_HIDDEN_SCALE);
+        output += activation * outputWeights[neuron];
+    }
+    return (int)(output * NETWORK_EVAL_SCALE / (NETWORK_HIDDEN_SCALE * NETWORK_OUTPUT_SCALE));
+}
+
+bool Network::load(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    file.read((char *)hiddenWeights, sizeof(hiddenWeights));
+    file.read((char *)hiddenBiases, sizeof(hiddenBiases));
+    file.read((char *)outputWeights, sizeof(outputWeights));
+    file.read((char *)&outputBias, sizeof(outputBias));
+    // a file with the wrong size was made for a different network
+    return file && file.peek() == EOF;
+}
+
+uint64_t Network::getHash()
+{
+    // fnv-1a over the weights in the order they are saved in
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto add = [&](const void *data, size_t size)
+    {
+        for (size_t index = 0; index < size; index++)
+        {
+            hash = (hash ^ ((const uint8_t *)data)[index]) * 0x100000001B3ull;
+        }
+    };
+    add(hiddenWeights, sizeof(hiddenWeights));
+    add(hiddenBiases, sizeof(hiddenBiases));
+    add(outputWeights, sizeof(outputWeights));
+    add(&outputBias, sizeof(outputBias));
+    // 0 means the hand written evaluation
+    return hash | 1;
+}
+
+bool Network::save(const std::string &path)
+{
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char *)hiddenWeights, sizeof(hiddenWeights));
+    file.write((const char *)hiddenBiases, sizeof(hiddenBiases));
+    file.write((const char *)outputWeights, sizeof(outputWeights));
+    file.write((const char *)&outputBias, sizeof(outputBias));
+    return file.good();
+}
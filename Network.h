@@ -0,0 +1,51 @@
+//
+// Created by Joe Chrisman on 6/2/22.
+//
+
+#ifndef UNTITLED2_NETWORK_H
+#define UNTITLED2_NETWORK_H
+
+#include "Board.h"
+
+/*
+ * a small neural network that scores a position. there is one input for every piece type on every square,
+ * so a position only turns on as many inputs as there are pieces. that makes the hidden layer cheap to work out:
+ * we just add up the weights of the pieces on the board.
+ *
+ * the weights are integers, so evaluating the network doesn't need any floating point math.
+ * the Trainer learns the weights and saves them in this format
+ *
+ * the file is the weights one after another, little endian:
+ * NETWORK_INPUTS * NETWORK_HIDDEN int16 hidden weights (for input 0, then input 1 ...)
+ * NETWORK_HIDDEN int16 hidden biases
+ * NETWORK_HIDDEN int16 output weights
+ * 1 int32 output bias
+ */
+class Network
+{
+public:
+    Network();
+
+    int16_t hiddenWeights[NETWORK_INPUTS][NETWORK_HIDDEN];
+    int16_t hiddenBiases[NETWORK_HIDDEN];
+    int16_t outputWeights[NETWORK_HIDDEN];
+    int32_t outputBias;
+
+    // the input for a piece type on a square
+    static inline int getInput(int pieceType, uint8_t square)
+    {
+        return pieceType * 64 + square;
+    }
+
+    // return a positive value when the engine is winning, and a negative value when the engine is losing
+    int evaluate(Board::Position &position);
+
+    bool load(const std::string &path);
+    bool save(const std::string &path);
+
+    // a hash of every weight, to tell two networks apart. it is never 0
+    uint64_t getHash();
+};
+
+
+#endif //UNTITLED2_NETWORK_H
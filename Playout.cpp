@@ -0,0 +1,213 @@
+//
+// Created by Joe Chrisman on 6/11/22.
+//
+
+#include <atomic>
+#include <thread>
+#include "Playout.h"
+
+Playout::Playout(uint64_t seed)
+{
+    board = new Board();
+    generator = new MoveGen(board);
+    captureWeight = PLAYOUT_CAPTURE_WEIGHT;
+    // xorshift gets stuck on zero, and close seeds would start out looking alike, so spread the bits out first
+    random = seed * 0x9E3779B97F4A7C15ull | 1;
+}
+
+Playout::Result Playout::play(Board::Position &position, bool engineToMove, int &plies)
+{
+    board->position = position;
+    board->engineToMove = engineToMove;
+    board->update();
+
+    // plies since the last capture or pawn move, for the fifty move rule
+    int quietPlies = 0;
+    for (plies = 0; plies < PLAYOUT_MAX_PLIES; plies++)
+    {
+        bool isEngine = board->engineToMove;
+        if (isEngine)
+        {
+            generator->generateEngineMoves();
+        }
+        else
+        {
+            generator->generatePlayerMoves();
+        }
+
+        Board::Move *move = pickMove(generator->getGeneratedMoves());
+        if (!move)
+        {
+            // no legal moves. it is checkmate if we are in check, and stalemate if we are not
+            if (!generator->nodeInfo.checkers)
+            {
+                return DRAW;
+            }
+            return isEngine ? PLAYER_WIN : ENGINE_WIN;
+        }
+
+        bool isPawn = move->moving == PLAYER_PAWN || move->moving == ENGINE_PAWN;
+        quietPlies = move->captured != NONE || isPawn ? 0 : quietPlies + 1;
+        // makeMove() also updates the extra bitboards, so the board is ready for the next generation
+        if (isEngine)
+        {
+            board->makeMove<true>(*move);
+        }
+        else
+        {
+            board->makeMove<false>(*move);
+        }
+
+        if (quietPlies >= 100 || (move->captured != NONE && isInsufficientMaterial()))
+        {
+            plies++;
+            return DRAW;
+        }
+    }
+    return DRAW;
+}
+
+void Playout::benchmark(int threads, int seconds, int captureWeight)
+{
+    threads = std::max(threads, 1);
+    std::vector<Playout *> playouts;
+    for (int thread = 0; thread < threads; thread++)
+    {
+        playouts.push_back(new Playout(thread + 1));
+        playouts.back()->captureWeight = captureWeight;
+    }
+
+    // play games on the first few playouts at once, print how it went, and return the playouts per second of all of them
+    auto run = [&](int count)
+    {
+        struct Tally
+        {
+            uint64_t games;
+            uint64_t plies;
+            uint64_t results[3];
+        };
+        std::vector<Tally> tallies(count);
+        std::atomic<bool> isStopping(false);
+
+        std::vector<std::thread> workers;
+        auto start = std::chrono::steady_clock::now();
+        for (int thread = 0; thread < count; thread++)
+        {
+            workers.emplace_back([&, thread]()
+            {
+                Board initial;
+                // count on the stack, so the threads don't write to the same cache line after every game
+                Tally tally{0, 0, {0, 0, 0}};
+                while (!isStopping.load(std::memory_order_relaxed))
+                {
+                    int plies;
+                    Result result = playouts[thread]->play(initial.position, initial.engineToMove, plies);
+                    tally.games++;
+                    tally.plies += plies;
+                    tally.results[result]++;
+                }
+                tallies[thread] = tally;
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        isStopping = true;
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        Tally total{0, 0, {0, 0, 0}};
+        for (int thread = 0; thread < count; thread++)
+        {
+            Tally &tally = tallies[thread];
+            std::cout << "  thread " << thread << ": " << (uint64_t)(tally.games / elapsed) << " playouts/s, "
+                      << (uint64_t)(tally.plies / elapsed) << " plies/s" << std::endl;
+            total.games += tally.games;
+            total.plies += tally.plies;
+            for (int result = 0; result < 3; result++)
+            {
+                total.results[result] += tally.results[result];
+            }
+        }
+        uint64_t games = std::max(total.games, (uint64_t)1);
+        std::cout << count << (count == 1 ? " thread: " : " threads: ") << (uint64_t)(total.games / elapsed)
+                  << " playouts/s, " << total.plies / games << " plies per game, the engine won "
+                  << total.results[ENGINE_WIN] * 100 / games << "%, the player won "
+                  << total.results[PLAYER_WIN] * 100 / games << "%, "
+                  << total.results[DRAW] * 100 / games << "% drawn" << std::endl;
+        return total.games / elapsed;
+    };
+
+    double single = run(1);
+    if (threads > 1)
+    {
+        double all = run(threads);
+        std::cout << threads << " threads played " << all / std::max(single, 1.0) << " times as many playouts as 1 thread. "
+                  << "linear would be " << threads << ", and this machine has "
+                  << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+    }
+}
+
+uint64_t Playout::getRandom()
+{
+    // xorshift64*
+    random ^= random >> 12;
+    random ^= random << 25;
+    random ^= random >> 27;
+    return random * 0x2545F4914F6CDD1Dull;
+}
+
+Board::Move *Playout::pickMove(std::vector<Board::Move> &moves)
+{
+    // with pseudo legal generation, a move we pick might be illegal.
+    // it gets swapped past the end of the moves we still pick from, so it isn't picked again
+    int count = (int)moves.size();
+    while (count)
+    {
+        int index;
+        if (captureWeight == 1)
+        {
+            index = (int)(getRandom() % count);
+        }
+        else
+        {
+            // every move gets a share of the total weight, and the random number lands in one of the shares
+            int total = 0;
+            for (int move = 0; move < count; move++)
+            {
+                total += moves[move].captured != NONE ? captureWeight : 1;
+            }
+            int target = (int)(getRandom() % total);
+            for (index = 0; index < count - 1; index++)
+            {
+                target -= moves[index].captured != NONE ? captureWeight : 1;
+                if (target < 0)
+                {
+                    break;
+                }
+            }
+        }
+
+        if (generator->isLegalMove(moves[index]))
+        {
+            return &moves[index];
+        }
+        std::swap(moves[index], moves[--count]);
+    }
+    return nullptr;
+}
+
+bool Playout::isInsufficientMaterial()
+{
+    Board::Position &position = board->position;
+    // a pawn can still promote, and a rook or a queen can checkmate on its own
+    if (position.pieces[PLAYER_PAWN] | position.pieces[ENGINE_PAWN] | position.pieces[PLAYER_ROOK] |
+        position.pieces[ENGINE_ROOK] | position.pieces[PLAYER_QUEEN] | position.pieces[ENGINE_QUEEN])
+    {
+        return false;
+    }
+    // a king and a single knight or bishop can't checkmate a lone king
+    return countSetBits(position.pieces[PLAYER_KNIGHT] | position.pieces[ENGINE_KNIGHT] |
+                        position.pieces[PLAYER_BISHOP] | position.pieces[ENGINE_BISHOP]) <= 1;
+}
@@ -0,0 +1,65 @@
+//
+// Created by Joe Chrisman on 6/11/22.
+//
+
+#ifndef UNTITLED2_PLAYOUT_H
+#define UNTITLED2_PLAYOUT_H
+
+#include "MoveGen.h"
+
+/*
+ * plays random legal games to the end, as fast as we can. tree search experiments, random openings and datasets
+ * all need a lot of these.
+ *
+ * nothing is allocated while a game is played. the moves are generated into the generator's own vector, which
+ * keeps its memory from one ply to the next, and picked from there. the moves are only ever made, never unmade,
+ * so there is no copy of the position to keep. the random numbers come from a xorshift generator,
+ * which is a few instructions instead of a call to rand().
+ *
+ * every Playout has its own board and move generator, so each thread can have its own
+ */
+class Playout
+{
+public:
+    // making the move generator calls rand(), so make these on one thread before handing them out to others
+    Playout(uint64_t seed);
+
+    Board *board;
+    MoveGen *generator;
+
+    // how many times more likely a capture is to be picked than a quiet move. starts as PLAYOUT_CAPTURE_WEIGHT
+    int captureWeight;
+
+    enum Result
+    {
+        ENGINE_WIN,
+        PLAYER_WIN,
+        DRAW
+    };
+
+    /*
+     * play random moves from the position until the game is over: checkmate, stalemate, the fifty move rule,
+     * no pieces left that can checkmate, or PLAYOUT_MAX_PLIES. repetitions are not counted.
+     * the board is left at the end of the game, and plies is how many moves were played
+     */
+    Result play(Board::Position &position, bool engineToMove, int &plies);
+
+    /*
+     * play random games from the start position for the given number of seconds, with one thread and then with
+     * the given number of threads, and print how many playouts every thread played per second and how close
+     * the threads came to scaling linearly
+     */
+    static void benchmark(int threads, int seconds, int captureWeight);
+
+private:
+    uint64_t random;
+
+    uint64_t getRandom();
+    // pick a random legal move out of the generated ones, or return null if there is none
+    Board::Move *pickMove(std::vector<Board::Move> &moves);
+    // true if neither side has enough pieces left to checkmate
+    bool isInsufficientMaterial();
+};
+
+
+#endif //UNTITLED2_PLAYOUT_H
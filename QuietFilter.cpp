@@ -0,0 +1,214 @@
+//
+// Created by Joe Chrisman on 6/5/22.
+//
+
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include "QuietFilter.h"
+
+QuietFilter::QuietFilter(int threads, Metrics *metrics)
+{
+    this->metrics = metrics;
+    stats = FilterStats{0, 0, 0, 0, 0, 0};
+    // making the move generators takes a while, but it only happens once
+    for (int thread = 0; thread < std::max(threads, 1); thread++)
+    {
+        Worker worker;
+        worker.board = new Board();
+        worker.generator = new MoveGen(worker.board);
+        worker.search = new Search(worker.generator);
+        worker.metrics = metrics ? metrics->addWorker() : nullptr;
+        workers.push_back(worker);
+    }
+}
+
+bool QuietFilter::filter(const std::string &inputPath, const std::string &outputPath)
+{
+    bool isDataset = inputPath.size() >= 4 && inputPath.compare(inputPath.size() - 4, 4, ".bin") == 0;
+    std::ifstream input(inputPath, isDataset ? std::ios::binary : std::ios::in);
+    std::ofstream output(outputPath, std::ios::binary);
+    if (!input || !output)
+    {
+        return false;
+    }
+
+    std::vector<std::string> lines;
+    std::vector<Trainer::Sample> samples;
+    std::vector<Candidate> candidates;
+    while (true)
+    {
+        // read the next chunk of positions
+        int count = 0;
+        if (isDataset)
+        {
+            samples.resize(QUIET_FILTER_CHUNK_SIZE);
+            while (count < QUIET_FILTER_CHUNK_SIZE && Trainer::readSample(input, samples[count]))
+            {
+                count++;
+            }
+        }
+        else
+        {
+            lines.resize(QUIET_FILTER_CHUNK_SIZE);
+            while (count < QUIET_FILTER_CHUNK_SIZE && std::getline(input, lines[count]))
+            {
+                count++;
+            }
+        }
+        if (!count)
+        {
+            break;
+        }
+
+        if (metrics)
+        {
+            metrics->queued.fetch_add(count, std::memory_order_relaxed);
+        }
+
+        // give each thread an equal slice of the chunk
+        candidates.resize(count);
+        std::vector<std::thread> threads;
+        int slice = (count + (int)workers.size() - 1) / (int)workers.size();
+        for (int thread = 0; thread < (int)workers.size(); thread++)
+        {
+            threads.emplace_back([&, thread]()
+            {
+                Worker &worker = workers[thread];
+                auto start = std::chrono::steady_clock::now();
+                uint64_t nodesBefore = worker.search->stats.nodes;
+                if (worker.metrics)
+                {
+                    worker.metrics->searching.store(true, std::memory_order_relaxed);
+                }
+
+                int end = std::min(count, (thread + 1) * slice);
+                for (int index = thread * slice; index < end; index++)
+                {
+                    if (isDataset)
+                    {
+                        checkSample(worker, samples[index], candidates[index]);
+                    }
+                    else
+                    {
+                        checkLine(worker, lines[index], candidates[index]);
+                    }
+                    if (worker.metrics)
+                    {
+                        worker.metrics->jobs.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+
+                if (worker.metrics)
+                {
+                    auto busy = std::chrono::steady_clock::now() - start;
+                    worker.metrics->busyMicroseconds.fetch_add(
+                            std::chrono::duration_cast<std::chrono::microseconds>(busy).count(), std::memory_order_relaxed);
+                    worker.metrics->nodes.fetch_add(worker.search->stats.nodes - nodesBefore, std::memory_order_relaxed);
+                    worker.metrics->searching.store(false, std::memory_order_relaxed);
+                }
+            });
+        }
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+
+        // write the quiet positions in the order they were read, so the output is the same with any number of threads
+        for (int index = 0; index < count; index++)
+        {
+            Candidate &candidate = candidates[index];
+            stats.read++;
+            if (candidate.verdict == INVALID)
+            {
+                stats.invalid++;
+            }
+            else if (candidate.verdict == IN_CHECK)
+            {
+                stats.inCheck++;
+            }
+            else if (candidate.verdict == NOT_QUIET)
+            {
+                stats.notQuiet++;
+            }
+            else if (!written.insert(candidate.key).second)
+            {
+                stats.duplicates++;
+            }
+            else
+            {
+                Trainer::writeSample(output, candidate.position, candidate.score);
+                stats.written++;
+            }
+        }
+    }
+
+    std::cout << stats.read << " positions read, " << stats.invalid << " invalid, " << stats.inCheck << " in check, "
+              << stats.notQuiet << " not quiet, " << stats.duplicates << " duplicates, " << stats.written << " written"
+              << std::endl;
+    return output.good();
+}
+
+QuietFilter::Verdict QuietFilter::checkPosition(Worker &worker, bool isEngine, int &score)
+{
+    worker.board->update();
+    if (worker.generator->isKingInCheck(isEngine))
+    {
+        return IN_CHECK;
+    }
+
+    // search with a window just above the evaluation (or just below it for the player).
+    // the quiescence search only gets outside the window if a capture does better than standing pat
+    score = worker.search->evaluator.evaluate(worker.board->position);
+    bool isQuiet = isEngine ? worker.search->quiesceMax(0, score, score + 1, false) <= score
+                            : worker.search->quiesceMin(0, score - 1, score, false) >= score;
+    return isQuiet ? KEEP : NOT_QUIET;
+}
+
+void QuietFilter::checkLine(Worker &worker, const std::string &line, Candidate &candidate)
+{
+    Board *board = worker.board;
+    candidate.verdict = INVALID;
+    // loadFen() already turns away positions without both kings, or where the side that just moved is in check
+    if (!board->loadFen(line))
+    {
+        return;
+    }
+
+    int score = 0;
+    candidate.verdict = checkPosition(worker, board->engineToMove, score);
+    candidate.position = Board::Position{};
+    std::copy(board->position.pieces, board->position.pieces + 12, candidate.position.pieces);
+    candidate.score = (int16_t)std::min(std::max(score, -INT16_MAX), (int)INT16_MAX);
+    // samples don't know whose turn it is, so neither does the key
+    candidate.key = worker.search->table.getKey(candidate.position, false);
+}
+
+void QuietFilter::checkSample(Worker &worker, Trainer::Sample &sample, Candidate &candidate)
+{
+    candidate.verdict = INVALID;
+    candidate.position = Board::Position{};
+    std::copy(sample.pieces, sample.pieces + 12, candidate.position.pieces);
+    candidate.score = sample.score;
+    if (countSetBits(sample.pieces[ENGINE_KING]) != 1 || countSetBits(sample.pieces[PLAYER_KING]) != 1)
+    {
+        return;
+    }
+    candidate.key = worker.search->table.getKey(candidate.position, false);
+
+    // we don't know whose turn it is, so the position has to be quiet for both sides.
+    // look at both kings first, because searching with the wrong side to move could capture a king
+    worker.board->position = candidate.position;
+    worker.board->update();
+    if (worker.generator->isKingInCheck(true) || worker.generator->isKingInCheck(false))
+    {
+        candidate.verdict = IN_CHECK;
+        return;
+    }
+    int score = 0;
+    candidate.verdict = checkPosition(worker, true, score);
+    if (candidate.verdict == KEEP)
+    {
+        candidate.verdict = checkPosition(worker, false, score);
+    }
+}
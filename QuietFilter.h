@@ -0,0 +1,82 @@
+//
+// Created by Joe Chrisman on 6/5/22.
+//
+
+#ifndef UNTITLED2_QUIETFILTER_H
+#define UNTITLED2_QUIETFILTER_H
+
+#include <unordered_set>
+#include "Search.h"
+#include "Trainer.h"
+
+/*
+ * tuning the evaluation only works on quiet positions. if a capture is hanging, the evaluation of the position
+ * is wrong, and the tuner would learn from a wrong score. this throws those positions away.
+ *
+ * a position is quiet if the side to move is not in check, and a captures-only quiescence search
+ * can't do better than the static evaluation. the positions that are left are written as Trainer samples,
+ * and every position is only written once.
+ *
+ * the input is either a text file with a FEN or EPD position on every line, or a binary Trainer dataset
+ * (when the file name ends in ".bin"). positions from text get the static evaluation as their score,
+ * positions from a dataset keep their score. a dataset doesn't say whose turn it is,
+ * so those positions have to be quiet no matter who is to move
+ */
+class QuietFilter
+{
+public:
+    // metrics can be null. otherwise every thread reports to its own worker there
+    QuietFilter(int threads, Metrics *metrics);
+
+    struct FilterStats
+    {
+        uint64_t read;
+        uint64_t invalid; // lines that were not a position
+        uint64_t inCheck;
+        uint64_t notQuiet;
+        uint64_t duplicates;
+        uint64_t written;
+    } stats;
+
+    bool filter(const std::string &inputPath, const std::string &outputPath);
+
+private:
+    // every thread gets its own board to search on
+    struct Worker
+    {
+        Board *board;
+        MoveGen *generator;
+        Search *search;
+        Metrics::Worker *metrics;
+    };
+    std::vector<Worker> workers;
+    Metrics *metrics;
+
+    // what happened to one position of the input
+    enum Verdict
+    {
+        KEEP,
+        INVALID,
+        IN_CHECK,
+        NOT_QUIET
+    };
+
+    struct Candidate
+    {
+        Verdict verdict;
+        // only the pieces of the position are written, so the castling rights and the en passant square are cleared
+        Board::Position position;
+        int16_t score;
+        uint64_t key;
+    };
+
+    // the keys of every position we wrote so far
+    std::unordered_set<uint64_t> written;
+
+    Verdict checkPosition(Worker &worker, bool isEngine, int &score);
+    void checkLine(Worker &worker, const std::string &line, Candidate &candidate);
+    void checkSample(Worker &worker, Trainer::Sample &sample, Candidate &candidate);
+};
+
+
+#endif //UNTITLED2_QUIETFILTER_H
@@ -0,0 +1,255 @@
+//
+// Created by Joe Chrisman on 6/9/22.
+//
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include "Scheduler.h"
+
+Scheduler::Scheduler(EngineConfig &config, MovePrior *prior, Network *network, Metrics *metrics,
+                     const std::string &sharedTable, SearchLog *searchLog)
+{
+    this->metrics = metrics;
+    for (int index = 0; index < SCHEDULER_ENGINES; index++)
+    {
+        Engine engine;
+        engine.board = new Board();
+        engine.generator = new MoveGen(engine.board);
+        engine.generator->prior = prior;
+        engine.search = new Search(engine.generator);
+        engine.search->evaluator.network = network;
+        config.apply(engine.search);
+        engine.search->keepTable = true;
+        // every job's root moves and stats are too much to read with this many jobs
+        engine.search->quiet = true;
+        if (!sharedTable.empty())
+        {
+            engine.search->table.share(sharedTable, network);
+        }
+        engine.search->metrics = metrics ? metrics->addWorker() : nullptr;
+        engine.search->log = searchLog ? searchLog->addSearcher() : nullptr;
+        engine.job = -1;
+        engines.push_back(engine);
+    }
+}
+
+bool Scheduler::load(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+
+    std::string line;
+    Board board;
+    while (std::getline(file, line))
+    {
+        std::istringstream stream(line);
+        Job job;
+        std::string fen;
+        if (!(stream >> job.arrival >> job.deadline >> job.priority) || !std::getline(stream, fen))
+        {
+            continue;
+        }
+        // the search only knows how to find moves for the engine
+        if (!board.loadFen(fen) || !board.engineToMove)
+        {
+            continue;
+        }
+        job.id = (int)jobs.size();
+        job.position = board.position;
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+void Scheduler::run()
+{
+    results.clear();
+    states.assign(jobs.size(), JobState{false, false, -1, -1, 0});
+
+    auto start = std::chrono::steady_clock::now();
+    auto getTime = [&]()
+    {
+        return (int64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    int remaining = (int)jobs.size();
+    while (remaining)
+    {
+        // find the most urgent job that has arrived
+        int64_t time = getTime();
+        int picked = -1;
+        int64_t nextArrival = INT64_MAX;
+        for (int job = 0; job < (int)jobs.size(); job++)
+        {
+            if (states[job].done)
+            {
+                continue;
+            }
+            if (jobs[job].arrival > time)
+            {
+                nextArrival = std::min(nextArrival, jobs[job].arrival);
+                continue;
+            }
+            if (!states[job].arrived && metrics)
+            {
+                metrics->queued.fetch_add(1, std::memory_order_relaxed);
+            }
+            states[job].arrived = true;
+            if (picked < 0 || isMoreUrgent(job, picked))
+            {
+                picked = job;
+            }
+        }
+        if (picked < 0)
+        {
+            // nothing to do until the next job shows up
+            std::this_thread::sleep_for(std::chrono::milliseconds(nextArrival - time));
+            continue;
+        }
+
+        if (states[picked].engine < 0)
+        {
+            // the engine that searched this job before has the warmest table for it, so try that one first
+            int engine = -1;
+            int lastEngine = states[picked].lastEngine;
+            if (lastEngine >= 0 && engines[lastEngine].job < 0)
+            {
+                engine = lastEngine;
+            }
+            for (int index = 0; engine < 0 && index < (int)engines.size(); index++)
+            {
+                if (engines[index].job < 0)
+                {
+                    engine = index;
+                }
+            }
+            // every engine is busy. the picked job is the most urgent one, so stop the least urgent search
+            if (engine < 0)
+            {
+                for (int index = 0; index < (int)engines.size(); index++)
+                {
+                    if (engine < 0 || isMoreUrgent(engines[engine].job, engines[index].job))
+                    {
+                        engine = index;
+                    }
+                }
+                int stopped = engines[engine].job;
+                engines[engine].search->stopSearch();
+                states[stopped].engine = -1;
+                states[stopped].preemptions++;
+            }
+            startJob(picked, engine);
+        }
+
+        Engine &engine = engines[states[picked].engine];
+        if (engine.search->continueSearch(SCHEDULER_SLICE_MS))
+        {
+            Job &job = jobs[picked];
+            int64_t milliseconds = getTime() - job.arrival;
+            results.push_back(Result{
+                job.id,
+                engine.search->getSearchResult(),
+                job.priority,
+                milliseconds,
+                milliseconds > job.deadline,
+                states[picked].preemptions
+            });
+            if (engine.search->metrics)
+            {
+                engine.search->metrics->jobs.fetch_add(1, std::memory_order_relaxed);
+                engine.search->metrics->deadlinesMissed.fetch_add(results.back().missed, std::memory_order_relaxed);
+            }
+            states[picked].done = true;
+            states[picked].engine = -1;
+            engine.job = -1;
+            remaining--;
+        }
+    }
+
+    printReport();
+}
+
+bool Scheduler::isMoreUrgent(int a, int b)
+{
+    if (jobs[a].priority != jobs[b].priority)
+    {
+        return jobs[a].priority > jobs[b].priority;
+    }
+    int64_t deadlineA = jobs[a].arrival + jobs[a].deadline;
+    int64_t deadlineB = jobs[b].arrival + jobs[b].deadline;
+    if (deadlineA != deadlineB)
+    {
+        return deadlineA < deadlineB;
+    }
+    return a < b;
+}
+
+void Scheduler::startJob(int job, int engine)
+{
+    Board *board = engines[engine].board;
+    board->position = jobs[job].position;
+    board->engineToMove = true;
+    board->update();
+    engines[engine].search->startSearch();
+    engines[engine].job = job;
+    states[job].engine = engine;
+    states[job].lastEngine = engine;
+}
+
+void Scheduler::printReport()
+{
+    if (results.empty())
+    {
+        std::cout << "there were no jobs" << std::endl;
+        return;
+    }
+
+    // the deadline misses for every priority, from the highest priority to the lowest
+    std::vector<int> priorities;
+    for (Result &result : results)
+    {
+        if (std::find(priorities.begin(), priorities.end(), result.priority) == priorities.end())
+        {
+            priorities.push_back(result.priority);
+        }
+    }
+    std::sort(priorities.rbegin(), priorities.rend());
+
+    auto printLine = [](const std::string &name, int count, int missed, int64_t milliseconds, int preemptions)
+    {
+        std::cout << name << ": " << count << " jobs, " << missed << " missed their deadline ("
+                  << missed * 100 / count << "%), " << milliseconds / count << "ms on average, "
+                  << preemptions << " preemptions" << std::endl;
+    };
+
+    int totalMissed = 0;
+    int64_t totalMilliseconds = 0;
+    int totalPreemptions = 0;
+    for (int priority : priorities)
+    {
+        int count = 0;
+        int missed = 0;
+        int64_t milliseconds = 0;
+        int preemptions = 0;
+        for (Result &result : results)
+        {
+            if (result.priority == priority)
+            {
+                count++;
+                missed += result.missed;
+                milliseconds += result.milliseconds;
+                preemptions += result.preemptions;
+            }
+        }
+        printLine("priority " + std::to_string(priority), count, missed, milliseconds, preemptions);
+        totalMissed += missed;
+        totalMilliseconds += milliseconds;
+        totalPreemptions += preemptions;
+    }
+    printLine("all", (int)results.size(), totalMissed, totalMilliseconds, totalPreemptions);
+}
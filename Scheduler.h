@@ -0,0 +1,96 @@
+//
+// Created by Joe Chrisman on 6/9/22.
+//
+
+#ifndef UNTITLED2_SCHEDULER_H
+#define UNTITLED2_SCHEDULER_H
+
+#include "EngineConfig.h"
+
+/*
+ * runs many analysis jobs on a few engines, so a quick job doesn't have to wait for a deep one to finish.
+ * every job is a position to search with the engine to move, a priority and a deadline.
+ *
+ * the jobs are searched with the time sliced search, one slice at a time. before every slice we pick the most
+ * urgent job: the highest priority first, then the earliest deadline. a job that isn't picked just waits
+ * in the middle of its search, so it loses nothing. there are only SCHEDULER_ENGINES engines though.
+ * when they are all busy and a more urgent job shows up, the least urgent search is stopped, and it starts
+ * over once an engine is free again. the engines keep their transposition tables between jobs,
+ * so the search that starts over goes quickly through the part it already did
+ */
+class Scheduler
+{
+public:
+    /*
+     * every engine gets the same settings. the prior, the network and the metrics can be null.
+     * with metrics, every engine reports to its own worker, and the jobs count as queued when they arrive.
+     * if sharedTable is not empty, every engine uses the shared main table with that name.
+     * if searchLog is not null, every engine records its searches in it as its own searcher
+     */
+    Scheduler(EngineConfig &config, MovePrior *prior, Network *network, Metrics *metrics, const std::string &sharedTable,
+              SearchLog *searchLog);
+
+    struct Job
+    {
+        int id;
+        Board::Position position;
+        int priority; // higher runs first
+        int64_t arrival; // milliseconds from the start of run() until the job is handed to us
+        int64_t deadline; // milliseconds from its arrival until we should have its move
+    };
+
+    struct Result
+    {
+        int id;
+        Board::Move best;
+        int priority;
+        int64_t milliseconds; // from its arrival to its move
+        bool missed; // true if it took longer than its deadline
+        int preemptions; // how many times its search was stopped for a more urgent job
+    };
+    std::vector<Result> results;
+
+    /*
+     * read the jobs from a text file, one per line: the arrival and the deadline in milliseconds,
+     * the priority and then a FEN position with the engine to move. returns false if the file can't be read.
+     * lines that don't make sense are skipped
+     */
+    bool load(const std::string &path);
+
+    // run every job until it has a move, then print how many deadlines were missed
+    void run();
+
+private:
+    // one board with its own move generator and search. a job keeps its engine until its search is over
+    struct Engine
+    {
+        Board *board;
+        MoveGen *generator;
+        Search *search;
+        int job; // the index of the job being searched, or -1 if the engine is free
+    };
+    std::vector<Engine> engines;
+    Metrics *metrics;
+
+    std::vector<Job> jobs;
+
+    // what we know about each job while run() is going
+    struct JobState
+    {
+        bool arrived;
+        bool done;
+        int engine; // the engine it is on, or -1
+        int lastEngine; // the engine that searched it last. its table is warm for this job
+        int preemptions;
+    };
+    std::vector<JobState> states;
+
+    // true if job a should run before job b
+    bool isMoreUrgent(int a, int b);
+    // put a job on an engine and start its search
+    void startJob(int job, int engine);
+    void printReport();
+};
+
+
+#endif //UNTITLED2_SCHEDULER_H
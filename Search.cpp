@@ -2,61 +2,307 @@
 // Created by Joe Chrisman on 2/24/22.
 //
 
+#include <algorithm>
 #include "Search.h"
 
 Search::Search(MoveGen *generator)
 {
     this->generator = generator;
     this->board = generator->board;
-
+    this->mateInOneDetection = MATE_IN_ONE_DETECTION;
+    this->attackTables = ATTACK_TABLES;
+    this->metrics = nullptr;
+    this->log = nullptr;
+    this->keepTable = false;
+    this->quiet = false;
+    resetSearch();
 }
 
-// make every possible engine move, and get a score for each move by
-// doing a recursive depth first search. then return the highest score we found
-int Search::maximize(int ply, int alpha, int beta)
+/*
+ * make every possible move for the side to move, and get a score for each move by
+ * doing a recursive depth first search. the engine returns the highest score we found, and the player the lowest.
+ *
+ * nodeType and isEngine are known when compiling, so every "if" on them below is decided by the compiler.
+ * the root only reports its moves, pv nodes never prune, and non pv nodes never have to check their window
+ */
+template<Search::NodeType nodeType, bool isEngine>
+int Search::search(int ply, int alpha, int beta)
 {
     // if we have reached a leaf node in our search
-    if (ply > SEARCH_DEPTH)
+    if (nodeType != ROOT && ply > SEARCH_DEPTH)
     {
-        // return the evaluation score through the recursive callers above
-        return evaluator.evaluate(board->position);
+        // settle any captures that are still going on, and return the score through the recursive callers above
+        return isEngine ? quiesceMax(ply, alpha, beta, true) : quiesceMin(ply, alpha, beta, true);
+    }
+    if (nodeType != ROOT)
+    {
+        stats.nodes++;
     }
 
-    int bestScore = MIN_EVAL;
+    // look for this position in the transposition table.
+    // the root has to search every move anyway, and a pv node only takes the move, so the score stays exact along the pv
+    TranspositionTable::Entry *entry = nullptr;
+    uint64_t key = 0;
+    if (nodeType != ROOT)
+    {
+        key = table.getKey(board->position, isEngine);
+        entry = table.probe(key, SEARCH_DEPTH + 1 - ply);
+        if (nodeType == NON_PV && entry)
+        {
+            int score = TranspositionTable::getScore(entry, ply);
+            if (entry->bound == TranspositionTable::EXACT ||
+                (entry->bound == TranspositionTable::LOWER_BOUND && score >= beta) ||
+                (entry->bound == TranspositionTable::UPPER_BOUND && score <= alpha))
+            {
+                return score;
+            }
+        }
+    }
+    int originalAlpha = alpha;
+    int originalBeta = beta;
+    Board::Move best{};
 
-    generator->generateEngineMoves();
+    // start with the worst score for the side to move.
+    // checkmate in 1 for the engine will return a score of MAX_EVAL - 1
+    // the engine being checkmated in 1 will return a score of MIN_EVAL + 1
+    int bestScore = isEngine ? MIN_EVAL : MAX_EVAL;
+
+    if (isEngine)
+    {
+        generator->generateEngineMoves();
+    }
+    else
+    {
+        generator->generatePlayerMoves();
+    }
     std::vector<Board::Move> moves = generator->getSortedMoves();
-    // if there are no moves, the engine is in checkmate or stalemate
-    if (moves.empty())
+    // remember this now, because the nodes below us will overwrite the node info
+    bool inCheck = generator->nodeInfo.checkers;
+
+    // one ply above the leaves, a mate in one is cheaper to spot than to search for.
+    // the score is the same one the search would give the mate
+    if (nodeType != ROOT && mateInOneDetection && ply == SEARCH_DEPTH && generator->canMateInOne(isEngine, moves))
+    {
+        stats.matesInOne++;
+        return isEngine ? MAX_EVAL - (ply + 1) : MIN_EVAL + (ply + 1);
+    }
+    orderHashMove(moves, entry);
+
+    // the quiet moves we searched that did not cause a cutoff
+    std::vector<Board::Move> quiets;
+    int legalMoves = 0;
+    for (Board::Move &move : moves)
+    {
+        // with pseudo legal generation, this move might leave our king in check
+        if (!generator->isLegalMove(move))
+        {
+            continue;
+        }
+        legalMoves++;
+
+        Board::Position clone = board->position;
+        board->makeMove<isEngine>(move);
+
+        // skip quiet moves that are very unlikely to matter this close to the leaves.
+        // the root and the pv nodes search every move
+        if (nodeType == NON_PV && isPrunable(move, ply, inCheck, legalMoves - 1, isEngine))
+        {
+            board->restore(clone);
+            continue;
+        }
+
+        int score;
+        if (nodeType == ROOT)
+        {
+            // every root move gets the full window
+            score = search<PV, !isEngine>(ply + 1, MIN_EVAL, MAX_EVAL);
+        }
+        else if (nodeType == PV && alpha == MIN_EVAL && beta == MAX_EVAL)
+        {
+            // until a move improves the window, a pv node passes the full window down
+            score = search<PV, !isEngine>(ply + 1, alpha, beta);
+        }
+        else
+        {
+            // a window that isn't full only gets smaller further down, so everything below here is a non pv node
+            score = search<NON_PV, !isEngine>(ply + 1, alpha, beta);
+        }
+
+        if (nodeType == ROOT)
+        {
+            if (!quiet)
+            {
+                std::cout << board->getMoveNotation(move) << ": " << score << std::endl;
+            }
+            if (score > bestScore)
+            {
+                bestScore = score;
+                rootBest = move;
+            }
+            // unmake the move. the root never cuts off, so there is nothing else to do
+            board->restore(clone);
+            continue;
+        }
+
+        // unmake the move
+        board->restore(clone);
+
+        if (isEngine)
+        {
+            if (score > bestScore)
+            {
+                bestScore = score;
+                best = move;
+            }
+            if (bestScore > alpha)
+            {
+                alpha = bestScore;
+            }
+        }
+        else
+        {
+            if (score < bestScore)
+            {
+                bestScore = score;
+                best = move;
+            }
+            if (bestScore < beta)
+            {
+                beta = bestScore;
+            }
+        }
+        if (beta <= alpha)
+        {
+            updateHistory(move, quiets, ply);
+            // no need to do more searching
+            break;
+        }
+        if (move.captured == NONE && move.type == Board::NORMAL)
+        {
+            quiets.push_back(move);
+        }
+    }
+    // if there are no moves, the side to move is in checkmate or stalemate
+    if (nodeType != ROOT && !legalMoves)
     {
         // if our king is checked by our opponent
-        if (generator->isKingInCheck(true))
+        if (inCheck)
         {
-            // the engine is in checkmate. return a very low evaluation.
-            // if we are deeper in the search, make that evaluation a little higher.
-            // this way, the engine always chooses the longest mating line possible
-            return MIN_EVAL + ply;
+            // checkmate. if we are deeper in the search, make the score a little closer to 0.
+            // this way, the engine chooses the fastest checkmate for itself and the longest one against itself
+            bestScore = isEngine ? MIN_EVAL + ply : MAX_EVAL - ply;
         }
         // otherwise, stalemate
-        return 0;
+        else
+        {
+            bestScore = 0;
+        }
+    }
+    if (nodeType != ROOT)
+    {
+        storeNode(key, ply, originalAlpha, originalBeta, bestScore, best);
+    }
+    return bestScore;
+}
+
+int Search::maximize(int ply, int alpha, int beta)
+{
+    if (alpha == MIN_EVAL && beta == MAX_EVAL)
+    {
+        return search<PV, true>(ply, alpha, beta);
+    }
+    return search<NON_PV, true>(ply, alpha, beta);
+}
+
+int Search::minimize(int ply, int alpha, int beta)
+{
+    if (alpha == MIN_EVAL && beta == MAX_EVAL)
+    {
+        return search<PV, false>(ply, alpha, beta);
+    }
+    return search<NON_PV, false>(ply, alpha, beta);
+}
+
+
+/*
+ * the search stops at SEARCH_DEPTH, but the position there might be in the middle of a trade.
+ * so keep searching captures and promotions until the position is quiet, and only then trust the evaluation.
+ *
+ * on the first ply of the quiescence search, quiet moves that give check are searched too.
+ * a capture-only search misses a check that wins material on the next move.
+ * when the engine is in check, it can't ignore the check, so every move is searched and there is no standing pat
+ */
+int Search::quiesceMax(int ply, int alpha, int beta, bool quietChecks)
+{
+    stats.nodes++;
+    stats.maxPly = std::max(stats.maxPly, ply);
+    generator->updateNodeInfo(true);
+    bool inCheck = generator->nodeInfo.checkers;
+
+    int bestScore = MIN_EVAL;
+    if (!inCheck)
+    {
+        // the engine doesn't have to capture anything. so it can always settle for the evaluation of this position
+        bestScore = evaluator.evaluate(board->position);
+        if (bestScore > alpha)
+        {
+            alpha = bestScore;
+        }
+        if (beta <= alpha)
+        {
+            return bestScore;
+        }
+    }
+
+    generator->generateEngineMoves();
+    std::vector<Board::Move> generated = generator->getSortedMoves();
+
+    // standing pat isn't good enough. but if we can mate, nothing else matters
+    if (QUIESCENCE_MATE_DETECTION && !inCheck && generator->canMateInOne(true, generated))
+    {
+        stats.matesInOne++;
+        return MAX_EVAL - (ply + 1);
+    }
+
+    // figure out which moves are worth looking at
+    std::vector<Board::Move> moves;
+    for (Board::Move &move : generated)
+    {
+        if (inCheck || move.captured != NONE || move.type != Board::NORMAL)
+        {
+            moves.push_back(move);
+        }
+    }
+    if (!inCheck && quietChecks)
+    {
+        generator->generateEngineQuietChecks();
+        for (Board::Move &move : generator->getSortedMoves())
+        {
+            moves.push_back(move);
+        }
     }
 
+    int legalMoves = 0;
     for (Board::Move &move : moves)
     {
+        // with pseudo legal generation, this move might leave our king in check
+        if (!generator->isLegalMove(move))
+        {
+            continue;
+        }
+        legalMoves++;
+
         Board::Position clone = board->position;
-        // make a move for the engine
         board->makeMove<true>(move);
-
-        // make the moves for the player
-        int score = minimize(ply + 1, alpha, beta);
+        // only look for quiet checks on the first ply
+        int score = quiesceMin(ply + 1, alpha, beta, false);
         if (score > bestScore)
         {
             bestScore = score;
         }
 
         // unmake the move
-        board->position = clone;
-        board->engineToMove = !board->engineToMove;
+        board->restore(clone);
 
         if (bestScore > alpha)
         {
@@ -64,55 +310,89 @@ int Search::maximize(int ply, int alpha, int beta)
         }
         if (beta <= alpha)
         {
-            // no need to do more evaluating
             break;
         }
     }
+    // if the engine is in check and can't get out of it, it is checkmate
+    if (inCheck && !legalMoves)
+    {
+        return MIN_EVAL + ply;
+    }
     return bestScore;
 }
 
-// make every possible player move, and get a score for each move by
-// doing a recursive depth first search. then return the lowest score we found
-int Search::minimize(int ply, int alpha, int beta)
+// the same as quiesceMax(), but for the player
+int Search::quiesceMin(int ply, int alpha, int beta, bool quietChecks)
 {
-    // if we have reached a leaf node in our search
-    if (ply > SEARCH_DEPTH)
-    {
-        // return the evaluation score through the recursive callers above
-        return evaluator.evaluate(board->position);
-    }
+    stats.nodes++;
+    stats.maxPly = std::max(stats.maxPly, ply);
+    generator->updateNodeInfo(false);
+    bool inCheck = generator->nodeInfo.checkers;
 
     int bestScore = MAX_EVAL;
+    if (!inCheck)
+    {
+        // the player doesn't have to capture anything. so the player can always settle for the evaluation of this position
+        bestScore = evaluator.evaluate(board->position);
+        if (bestScore < beta)
+        {
+            beta = bestScore;
+        }
+        if (beta <= alpha)
+        {
+            return bestScore;
+        }
+    }
 
     generator->generatePlayerMoves();
-    std::vector<Board::Move> moves = generator->getSortedMoves();
-    // if there are no moves, the player is in checkmate or stalemate
-    if (moves.empty())
+    std::vector<Board::Move> generated = generator->getSortedMoves();
+
+    // standing pat isn't good enough. but if we can mate, nothing else matters
+    if (QUIESCENCE_MATE_DETECTION && !inCheck && generator->canMateInOne(false, generated))
     {
-        // if our king is checked by our opponent
-        if (generator->isKingInCheck(false))
+        stats.matesInOne++;
+        return MIN_EVAL + (ply + 1);
+    }
+
+    // figure out which moves are worth looking at
+    std::vector<Board::Move> moves;
+    for (Board::Move &move : generated)
+    {
+        if (inCheck || move.captured != NONE || move.type != Board::NORMAL)
         {
-            // the player is in checkmate. return a very high evaluation.
-            // if we are deeper in the search, make that evaluation a little lower
-            // this way, the engine will know to choose the fastest checkmate first
-            return MAX_EVAL - ply;
+            moves.push_back(move);
         }
-        // otherwise, stalemate
-        return 0;
     }
+    if (!inCheck && quietChecks)
+    {
+        generator->generatePlayerQuietChecks();
+        for (Board::Move &move : generator->getSortedMoves())
+        {
+            moves.push_back(move);
+        }
+    }
+
+    int legalMoves = 0;
     for (Board::Move &move : moves)
     {
+        // with pseudo legal generation, this move might leave our king in check
+        if (!generator->isLegalMove(move))
+        {
+            continue;
+        }
+        legalMoves++;
+
         Board::Position clone = board->position;
-        // make the move for the player
         board->makeMove<false>(move);
-        int score = maximize(ply + 1, alpha, beta);
+        // only look for quiet checks on the first ply
+        int score = quiesceMax(ply + 1, alpha, beta, false);
         if (score < bestScore)
         {
             bestScore = score;
         }
+
         // unmake the move
-        board->position = clone;
-        board->engineToMove = !board->engineToMove;
+        board->restore(clone);
 
         if (bestScore < beta)
         {
@@ -120,52 +400,594 @@ int Search::minimize(int ply, int alpha, int beta)
         }
         if (beta <= alpha)
         {
-            // no need to do any more searching
             break;
         }
     }
+    // if the player is in check and can't get out of it, it is checkmate
+    if (inCheck && !legalMoves)
+    {
+        return MAX_EVAL - ply;
+    }
     return bestScore;
 }
 
-
 // play every possible move the engine could make.
 // give each move a score, and choose the highest score.
 // this move leads to the best play for the engine
 Board::Move Search::getBestMove()
 {
     auto start = std::chrono::steady_clock::now();
-    Board::Move best;
-    // start with the lowest score. look for the highest score possible
-    // checkmate in 1 for the engine will return a score of MAX_EVAL - 1
-    // the engine being checkmated in 1 will return a score of MIN_EVAL + 1
-    int bestScore = MIN_EVAL;
+    rootBest = Board::Move{};
+    resetSearch();
+    if (log)
+    {
+        beginLog(false);
+    }
+    if (metrics)
+    {
+        metrics->searching.store(true, std::memory_order_relaxed);
+    }
+    generator->trackAttacks(attackTables);
 
-    generator->generateEngineMoves();
+    search<ROOT, true>(0, MIN_EVAL, MAX_EVAL);
+    generator->trackAttacks(false);
+
+    auto end = std::chrono::steady_clock::now();
+    auto difference = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+    if (!quiet)
+    {
+        std::cout << difference.count() << "ms elapsed.\n";
+        printStats();
+    }
+    uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    if (metrics)
+    {
+        metrics->busyMicroseconds.fetch_add(microseconds, std::memory_order_relaxed);
+        reportSearch(microseconds);
+    }
+    if (log)
+    {
+        endLog(true, microseconds, rootBest);
+    }
+
+    return rootBest;
+}
+
+/*
+ * walk the whole game tree to a given depth and count the positions at the bottom.
+ * the counts for the starting position are well known, so this is how we find move generation bugs.
+ * it is also a good way to time move generation, because there is no evaluation going on
+ */
+uint64_t Search::perft(int depth)
+{
+    bool isEngine = board->engineToMove;
+    if (isEngine)
+    {
+        generator->generateEngineMoves();
+    }
+    else
+    {
+        generator->generatePlayerMoves();
+    }
     std::vector<Board::Move> moves = generator->getSortedMoves();
-    // go through all the engine moves
+
+    uint64_t positions = 0;
     for (Board::Move &move : moves)
     {
-        Board::Position clone = board->position;
+        // with pseudo legal generation, this move might leave our king in check
+        if (!generator->isLegalMove(move))
+        {
+            continue;
+        }
+        // no need to make the moves on the last ply, we only want to count them
+        if (depth == 1)
+        {
+            positions++;
+            continue;
+        }
 
-        // make the move
-        board->makeMove<true>(move);
-        // get the score for the move by doing a recursive depth first search
-        int score = minimize(1, MIN_EVAL, MAX_EVAL);
-        std::cout << board->getMoveNotation(move) << ": " << score << std::endl;
-        if (score > bestScore)
+        Board::Position clone = board->position;
+        if (isEngine)
         {
-            bestScore = score;
-            best = move;
+            board->makeMove<true>(move);
+        }
+        else
+        {
+            board->makeMove<false>(move);
         }
+        positions += perft(depth - 1);
 
         // unmake the move
-        board->position = clone;
-        board->engineToMove = !board->engineToMove;
+        board->restore(clone);
     }
+    return positions;
+}
+
+// set up the root of a time sliced search. the root is the same as the loop in getBestMove()
+void Search::startSearch()
+{
+    slicedStart = std::chrono::steady_clock::now();
+    slicedBest = Board::Move{};
+    slicedBestScore = MIN_EVAL;
+    resetSearch();
+    if (metrics)
+    {
+        metrics->searching.store(true, std::memory_order_relaxed);
+    }
+
+    frames.clear();
+    // make sure the extra bitboards match the position before we generate the root moves
+    board->update();
+    if (log)
+    {
+        beginLog(true);
+    }
+    generator->trackAttacks(attackTables);
+    generator->generateEngineMoves();
+    frames.push_back(SearchFrame{
+        generator->getSortedMoves(),
+        0,
+        0,
+        0,
+        MIN_EVAL,
+        MAX_EVAL,
+        MIN_EVAL,
+        true,
+        (bool)generator->nodeInfo.checkers,
+        true,
+        0,
+        MIN_EVAL,
+        MAX_EVAL,
+        Board::Move{},
+        {},
+        board->position
+    });
+}
+
+/*
+ * search for at most the given number of milliseconds, then give control back to the caller.
+ * this visits the tree in the exact same order as maximize() and minimize(), it just keeps
+ * the stack of nodes in the frames vector instead of on the call stack.
+ * returns true if the search is over
+ */
+bool Search::continueSearch(int milliseconds)
+{
+    auto sliceStart = std::chrono::steady_clock::now();
+    auto deadline = sliceStart + std::chrono::milliseconds(milliseconds);
+    int nodes = 0;
+
+    // the time between slices is not spent searching, so only the slices count as busy
+    auto addBusyTime = [&]()
+    {
+        if (metrics)
+        {
+            auto busy = std::chrono::steady_clock::now() - sliceStart;
+            metrics->busyMicroseconds.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(busy).count(),
+                                                std::memory_order_relaxed);
+        }
+    };
+
+    while (!frames.empty())
+    {
+        // looking at the clock is slow, so only look at it every once in a while
+        if (++nodes % 1024 == 0 && std::chrono::steady_clock::now() > deadline)
+        {
+            addBusyTime();
+            return false;
+        }
+
+        SearchFrame &frame = frames.back();
+        // a frame is done when it has no more moves to look at or when it failed high/low.
+        // the root frame never cuts off, because every root move gets a full window like in getBestMove()
+        if (frame.moveIndex == (int)frame.moves.size() || frame.beta <= frame.alpha)
+        {
+            int score = frame.bestScore;
+            // if there were no legal moves, the side to move is in checkmate or stalemate
+            if (!frame.legalMoves)
+            {
+                score = 0;
+                if (frame.inCheck)
+                {
+                    // prefer the longest line when we are getting mated, and the fastest line when we are mating
+                    score = frame.isEngine ? MIN_EVAL + frame.ply : MAX_EVAL - frame.ply;
+                }
+            }
+            if (frames.size() > 1)
+            {
+                storeNode(frame.key, frame.ply, frame.originalAlpha, frame.originalBeta, score, frame.best);
+            }
+            frames.pop_back();
+            // give the score to the parent frame, unless we just finished the root
+            if (!frames.empty())
+            {
+                returnScore(score);
+            }
+            continue;
+        }
+
+        // with pseudo legal generation, this move might leave our king in check
+        if (!generator->isLegalMove(frame.moves[frame.moveIndex]))
+        {
+            frame.moveIndex++;
+            continue;
+        }
+        frame.legalMoves++;
+
+        // make the next move in this frame
+        frame.clone = board->position;
+        if (frame.isEngine)
+        {
+            board->makeMove<true>(frame.moves[frame.moveIndex]);
+        }
+        else
+        {
+            board->makeMove<false>(frame.moves[frame.moveIndex]);
+        }
+
+        // skip quiet moves that are very unlikely to matter this close to the leaves
+        if (!frame.pvNode && isPrunable(frame.moves[frame.moveIndex], frame.ply, frame.inCheck, frame.legalMoves - 1, frame.isEngine))
+        {
+            board->restore(frame.clone);
+            frame.moveIndex++;
+            continue;
+        }
+
+        // the root gives each move a full window, every other node passes its window down
+        int score;
+        if (enterNode(frame.ply + 1, frame.alpha, frame.beta, !frame.isEngine, score))
+        {
+            returnScore(score);
+        }
+    }
+
+    generator->trackAttacks(false);
     auto end = std::chrono::steady_clock::now();
-    auto difference = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    auto difference = std::chrono::duration_cast<std::chrono::milliseconds>(end - slicedStart);
+    if (!quiet)
+    {
+        std::cout << difference.count() << "ms elapsed.\n";
+        printStats();
+    }
+    uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(end - slicedStart).count();
+    if (metrics)
+    {
+        addBusyTime();
+        reportSearch(microseconds);
+    }
+    if (log)
+    {
+        endLog(true, microseconds, slicedBest);
+    }
+
+    return true;
+}
+
+void Search::stopSearch()
+{
+    if (log && !frames.empty())
+    {
+        auto elapsed = std::chrono::steady_clock::now() - slicedStart;
+        endLog(false, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(), slicedBest);
+    }
+    // every frame below the top one is in the middle of searching one of its moves, so unmake those moves
+    for (int index = (int)frames.size() - 2; index >= 0; index--)
+    {
+        board->restore(frames[index].clone);
+    }
+    frames.clear();
+    board->update();
+    generator->trackAttacks(false);
+    if (metrics)
+    {
+        metrics->searching.store(false, std::memory_order_relaxed);
+    }
+}
+
+bool Search::isSearching()
+{
+    return !frames.empty();
+}
+
+Board::Move Search::getSearchResult()
+{
+    return slicedBest;
+}
+
+/*
+ * the top of maximize() and minimize(). either score a leaf right away,
+ * or generate the moves for the node and push a frame so we can search them
+ */
+bool Search::enterNode(int ply, int alpha, int beta, bool isEngine, int &score)
+{
+    // if we have reached a leaf node in our search
+    if (ply > SEARCH_DEPTH)
+    {
+        score = isEngine ? quiesceMax(ply, alpha, beta, true) : quiesceMin(ply, alpha, beta, true);
+        return true;
+    }
+    stats.nodes++;
+
+    // the same transposition table lookup as search()
+    bool pvNode = alpha == MIN_EVAL && beta == MAX_EVAL;
+    uint64_t key = table.getKey(board->position, isEngine);
+    TranspositionTable::Entry *entry = table.probe(key, SEARCH_DEPTH + 1 - ply);
+    if (!pvNode && entry)
+    {
+        score = TranspositionTable::getScore(entry, ply);
+        if (entry->bound == TranspositionTable::EXACT ||
+            (entry->bound == TranspositionTable::LOWER_BOUND && score >= beta) ||
+            (entry->bound == TranspositionTable::UPPER_BOUND && score <= alpha))
+        {
+            return true;
+        }
+    }
+
+    if (isEngine)
+    {
+        generator->generateEngineMoves();
+    }
+    else
+    {
+        generator->generatePlayerMoves();
+    }
+
+    std::vector<Board::Move> moves = generator->getSortedMoves();
+    bool inCheck = generator->nodeInfo.checkers;
+
+    // the same mate in one shortcut as maximize() and minimize()
+    if (mateInOneDetection && ply == SEARCH_DEPTH && generator->canMateInOne(isEngine, moves))
+    {
+        stats.matesInOne++;
+        score = isEngine ? MAX_EVAL - (ply + 1) : MIN_EVAL + (ply + 1);
+        return true;
+    }
+    orderHashMove(moves, entry);
+
+    frames.push_back(SearchFrame{
+        moves,
+        0,
+        0,
+        ply,
+        alpha,
+        beta,
+        isEngine ? MIN_EVAL : MAX_EVAL,
+        isEngine,
+        inCheck,
+        pvNode,
+        key,
+        alpha,
+        beta,
+        Board::Move{},
+        {},
+        board->position
+    });
+    return false;
+}
+
+/*
+ * the bottom of the move loop in maximize() and minimize().
+ * unmake the move we searched, remember its score, and tighten the window
+ */
+void Search::returnScore(int score)
+{
+    SearchFrame &frame = frames.back();
+    Board::Move &move = frame.moves[frame.moveIndex];
+
+    // if this is the root, remember the best move like getBestMove() does
+    if (frames.size() == 1)
+    {
+        if (!quiet)
+        {
+            std::cout << board->getMoveNotation(move) << ": " << score << std::endl;
+        }
+        if (score > slicedBestScore)
+        {
+            slicedBestScore = score;
+            slicedBest = move;
+        }
+    }
+    else if (frame.isEngine)
+    {
+        if (score > frame.bestScore)
+        {
+            frame.bestScore = score;
+            frame.best = move;
+        }
+        if (frame.bestScore > frame.alpha)
+        {
+            frame.alpha = frame.bestScore;
+        }
+    }
+    else
+    {
+        if (score < frame.bestScore)
+        {
+            frame.bestScore = score;
+            frame.best = move;
+        }
+        if (frame.bestScore < frame.beta)
+        {
+            frame.beta = frame.bestScore;
+        }
+    }
 
-    std::cout << difference.count() << "ms elapsed.\n";
+    // remember the move for the history, like maximize() and minimize() do
+    if (frames.size() > 1)
+    {
+        if (frame.beta <= frame.alpha)
+        {
+            updateHistory(move, frame.quiets, frame.ply);
+        }
+        else if (move.captured == NONE && move.type == Board::NORMAL)
+        {
+            frame.quiets.push_back(move);
+        }
+    }
+
+    // unmake the move
+    board->restore(frame.clone);
+    frame.moveIndex++;
+}
+
+void Search::resetSearch()
+{
+    stats = SearchStats{0, 0, 0, 0, 0};
+    if (keepTable)
+    {
+        table.clearStats();
+    }
+    else
+    {
+        table.clear();
+    }
+    for (int piece = 0; piece < 12; piece++)
+    {
+        for (int square = 0; square < 64; square++)
+        {
+            history[piece][square] = 0;
+        }
+    }
+}
+
+void Search::beginLog(bool sliced)
+{
+    SearchLog::Record &record = log->pending;
+    record = SearchLog::Record{};
+    record.searcher = log->id;
+    record.depth = SEARCH_DEPTH;
+    record.position = board->position;
+    record.engineToMove = board->engineToMove;
+    record.flags = (generator->pseudoLegal ? SearchLog::PSEUDO_LEGAL : 0) |
+                   (generator->flippedGeneration ? SearchLog::FLIPPED : 0) |
+                   (mateInOneDetection ? SearchLog::MATE_IN_ONE : 0) |
+                   (attackTables ? SearchLog::ATTACK_TABLES : 0) |
+                   (keepTable ? SearchLog::KEEP_TABLE : 0) |
+                   (table.isShared() ? SearchLog::SHARED_TABLE : 0) |
+                   (generator->prior ? SearchLog::PRIOR : 0) |
+                   (evaluator.network ? SearchLog::NETWORK : 0) |
+                   (sliced ? SearchLog::SLICED : 0);
+    // the table was already cleared if we don't keep it, so this is what the search really starts with
+    record.tableHash = table.getHash();
+}
+
+void Search::endLog(bool finished, uint64_t microseconds, Board::Move &best)
+{
+    SearchLog::Record &record = log->pending;
+    record.flags |= finished ? SearchLog::FINISHED : 0;
+    record.nodes = stats.nodes;
+    record.microseconds = microseconds;
+    record.best = best;
+    log->write();
+}
+
+void Search::printStats()
+{
+    std::cout << stats.nodes << " nodes, " << stats.lateMovePrunes << " late move prunes, "
+              << stats.historyPrunes << " history prunes, " << stats.matesInOne << " mates in one, reached ply "
+              << stats.maxPly << ".\n";
 
-    return best;
-}
\ No newline at end of file
+    // how often each tier of the transposition table had the position we looked for
+    auto printTier = [](const char *name, TranspositionTable::TierStats &tier)
+    {
+        std::cout << name << " table: " << tier.hits << "/" << tier.probes << " hits ("
+                  << (tier.probes ? tier.hits * 100 / tier.probes : 0) << "%)";
+    };
+    printTier("front", table.frontStats);
+    std::cout << ", ";
+    printTier("main", table.mainStats);
+    std::cout << ".\n";
+}
+
+void Search::reportSearch(uint64_t microseconds)
+{
+    metrics->addSearch(stats.nodes, microseconds);
+    metrics->tableProbes.fetch_add(table.frontStats.probes + table.mainStats.probes, std::memory_order_relaxed);
+    metrics->tableHits.fetch_add(table.frontStats.hits + table.mainStats.hits, std::memory_order_relaxed);
+    metrics->tableFilled.store(table.frontStats.filled + table.mainStats.filled, std::memory_order_relaxed);
+    metrics->searching.store(false, std::memory_order_relaxed);
+}
+
+bool Search::isPrunable(Board::Move &move, int ply, bool inCheck, int moveCount, bool isEngine)
+{
+    int depth = SEARCH_DEPTH + 1 - ply;
+    // only quiet moves close to the leaves are skipped, and never the first move of a node
+    if (depth > QUIET_PRUNING_DEPTH || inCheck || !moveCount || move.captured != NONE || move.type != Board::NORMAL)
+    {
+        return false;
+    }
+
+    bool isLate = moveCount >= LATE_MOVE_COUNTS[depth];
+    bool isBadHistory = history[move.moving][move.to] < HISTORY_PRUNING_THRESHOLDS[depth];
+    if (!isLate && !isBadHistory)
+    {
+        return false;
+    }
+    // a quiet check could be the start of a mate, so it is always searched.
+    // this is checked last because it is the slowest
+    if (generator->isKingInCheck(!isEngine))
+    {
+        return false;
+    }
+
+    if (isLate)
+    {
+        stats.lateMovePrunes++;
+    }
+    else
+    {
+        stats.historyPrunes++;
+    }
+    return true;
+}
+
+void Search::orderHashMove(std::vector<Board::Move> &moves, TranspositionTable::Entry *entry)
+{
+    if (!entry || entry->from == entry->to)
+    {
+        return;
+    }
+    for (size_t index = 0; index < moves.size(); index++)
+    {
+        if (moves[index].from == entry->from && moves[index].to == entry->to)
+        {
+            // keep the rest of the moves in the order they were sorted in
+            std::rotate(moves.begin(), moves.begin() + index, moves.begin() + index + 1);
+            return;
+        }
+    }
+}
+
+void Search::storeNode(uint64_t key, int ply, int alpha, int beta, int bestScore, Board::Move &best)
+{
+    TranspositionTable::Bound bound = TranspositionTable::EXACT;
+    if (bestScore <= alpha)
+    {
+        bound = TranspositionTable::UPPER_BOUND;
+    }
+    else if (bestScore >= beta)
+    {
+        bound = TranspositionTable::LOWER_BOUND;
+    }
+    table.store(key, SEARCH_DEPTH + 1 - ply, ply, bestScore, bound, best);
+}
+
+void Search::updateHistory(Board::Move &cutoff, std::vector<Board::Move> &quiets, int ply)
+{
+    // captures are already sorted by what they capture, so they don't need a history
+    if (cutoff.captured != NONE || cutoff.type != Board::NORMAL)
+    {
+        return;
+    }
+    // cutoffs far from the leaves save the most work, so they count for more
+    int depth = SEARCH_DEPTH + 1 - ply;
+    int bonus = depth * depth;
+
+    int &score = history[cutoff.moving][cutoff.to];
+    score = std::min(score + bonus, HISTORY_LIMIT);
+    for (Board::Move &quiet : quiets)
+    {
+        int &failed = history[quiet.moving][quiet.to];
+        failed = std::max(failed - bonus, -HISTORY_LIMIT);
+    }
+}
@@ -5,7 +5,10 @@
 #ifndef UNTITLED2_SEARCH_H
 #define UNTITLED2_SEARCH_H
 
+#include "Metrics.h"
 #include "MoveGen.h"
+#include "SearchLog.h"
+#include "TranspositionTable.h"
 
 class Search
 {
@@ -16,10 +19,148 @@ public:
     MoveGen *generator;
     Board *board;
     Evaluation evaluator;
+    // cleared at the start of every search, like the history, unless keepTable is true
+    TranspositionTable table;
+    /*
+     * keep what the table knows from one search to the next. the entries are about positions, not about the root,
+     * so they stay right. a search that was stopped and started again then finds most of its work already done
+     */
+    bool keepTable;
+
+    // look for mates in one above the leaves with MoveGen::canMateInOne(). starts as MATE_IN_ONE_DETECTION
+    bool mateInOneDetection;
+    // keep attack tables on the board while searching (see MoveGen::trackAttacks()). starts as ATTACK_TABLES
+    bool attackTables;
+    // where to report every finished search, or null if nobody is watching
+    Metrics::Worker *metrics;
+    // where to record every search, so it can be replayed later, or null if we aren't recording
+    SearchLog::Searcher *log;
+    // don't print the root moves and the stats of every search. for the headless modes that search too often to read it all
+    bool quiet;
 
     Board::Move getBestMove();
+    // search a node below the root. these look at the window to pick the node type, then call search()
     int minimize(int ply, int alpha, int beta);
     int maximize(int ply, int alpha, int beta);
+    int quiesceMin(int ply, int alpha, int beta, bool quietChecks);
+    int quiesceMax(int ply, int alpha, int beta, bool quietChecks);
+
+    // count the positions at a given depth from the current position, for testing and timing move generation
+    uint64_t perft(int depth);
+
+    /*
+     * a resumable version of getBestMove() for builds that can't use threads.
+     * startSearch() sets up the root of the search, then every call to continueSearch() searches
+     * for a little while and gives control back to the caller. continueSearch() returns true once the
+     * search is over, and getSearchResult() returns the same move getBestMove() would have found.
+     *
+     * while the search is unfinished, the board is somewhere in the middle of the game tree.
+     * so nobody else should touch the board until the search is over
+     */
+    void startSearch();
+    bool continueSearch(int milliseconds);
+    // give up on the unfinished search and put the board back how it was when the search started
+    void stopSearch();
+    bool isSearching();
+    Board::Move getSearchResult();
+
+    // how much work the last search did. printed when a search is over
+    struct SearchStats
+    {
+        uint64_t nodes;
+        uint64_t lateMovePrunes; // quiet moves skipped because they came too late in the move list
+        uint64_t historyPrunes; // quiet moves skipped because of their history score
+        uint64_t matesInOne; // nodes scored by MoveGen::canMateInOne() instead of a search
+        int maxPly; // the deepest ply the quiescence search reached
+    } stats;
+
+private:
+
+    /*
+     * a score for every quiet move by piece and destination square. it goes up when the move causes a cutoff
+     * and goes down when the move was searched but another move caused the cutoff.
+     * it starts at 0 for every search
+     */
+    int history[12][64];
+
+    // clear the stats and the history before a search
+    void resetSearch();
+    void printStats();
+    // give the numbers of a finished search to the metrics. microseconds is the wall time from its start to its move
+    void reportSearch(uint64_t microseconds);
+    // write down what the search is starting from, and then how it ended
+    void beginLog(bool sliced);
+    void endLog(bool finished, uint64_t microseconds, Board::Move &best);
+
+    /*
+     * the kinds of nodes in the search.
+     * the root plays every engine move with the full window and remembers the best one.
+     * a pv node was entered with the full window, which only happens on the first line we search below each root move.
+     * every other node is a non pv node. only non pv nodes prune quiet moves
+     */
+    enum NodeType
+    {
+        ROOT,
+        PV,
+        NON_PV
+    };
+
+    // the best move the root found in the last search
+    Board::Move rootBest;
+
+    // maximize() if isEngine is true, minimize() if it is false.
+    // the compiler makes a separate copy for every node type and side
+    template<NodeType nodeType, bool isEngine>
+    int search(int ply, int alpha, int beta);
+
+    /*
+     * decide if a quiet move near the leaves of a non pv node is not worth searching. the move has already been made,
+     * because we have to know if it gives check. moveCount is how many legal moves came before it
+     */
+    bool isPrunable(Board::Move &move, int ply, bool inCheck, int moveCount, bool isEngine);
+
+    // search the move the table remembers first. it was the best move the last time we were here
+    void orderHashMove(std::vector<Board::Move> &moves, TranspositionTable::Entry *entry);
+    // remember the result of a node. the window it was searched with tells us what kind of bound the score is
+    void storeNode(uint64_t key, int ply, int alpha, int beta, int bestScore, Board::Move &best);
+
+    // reward the quiet move that caused a cutoff, and punish the quiet moves searched before it
+    void updateHistory(Board::Move &cutoff, std::vector<Board::Move> &quiets, int ply);
+
+    /*
+     * maximize() and minimize() keep their state on the call stack. the time sliced search can't do that,
+     * because it has to be able to stop in the middle of the tree and come back later.
+     * so it keeps one of these frames for every ply of the tree it is currently looking at
+     */
+    struct SearchFrame
+    {
+        std::vector<Board::Move> moves;
+        int moveIndex; // the move we are searching (or are about to search)
+        int legalMoves; // how many moves we searched so far
+        int ply;
+        int alpha;
+        int beta;
+        int bestScore;
+        bool isEngine; // true if this frame maximizes, false if it minimizes
+        bool inCheck;
+        bool pvNode;
+        uint64_t key; // the zobrist key of the node
+        int originalAlpha; // the window the node was entered with, to know what kind of bound its score is
+        int originalBeta;
+        Board::Move best;
+        std::vector<Board::Move> quiets; // the quiet moves we searched so far, for the history
+        Board::Position clone; // the position before we made the move we are searching
+    };
+
+    std::vector<SearchFrame> frames;
+    Board::Move slicedBest;
+    int slicedBestScore;
+    std::chrono::steady_clock::time_point slicedStart;
+
+    // try to push a frame for a new node. if the node is a leaf, return true and give back its score
+    bool enterNode(int ply, int alpha, int beta, bool isEngine, int &score);
+    // give the score of a finished child node back to the frame on top of the stack
+    void returnScore(int score);
 
 };
 
@@ -0,0 +1,175 @@
+//
+// Created by Joe Chrisman on 6/12/22.
+//
+
+#include "Search.h"
+
+SearchLog::SearchLog()
+{
+    searchers = 0;
+}
+
+bool SearchLog::open(const std::string &path)
+{
+    file.open(path, std::ios::binary | std::ios::trunc);
+    uint32_t header[2] = {SEARCH_LOG_VERSION, (uint32_t)sizeof(Record)};
+    file.write((char *)header, sizeof(header));
+    file.flush();
+    return file.good();
+}
+
+SearchLog::Searcher *SearchLog::addSearcher()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return new Searcher{this, searchers++, Record{}};
+}
+
+void SearchLog::Searcher::write()
+{
+    std::lock_guard<std::mutex> lock(log->mutex);
+    log->file.write((char *)&pending, sizeof(Record));
+    // the engine might never stop on its own, so don't keep the record in a buffer
+    log->file.flush();
+}
+
+std::vector<SearchLog::Record> SearchLog::load(const std::string &path)
+{
+    std::vector<Record> records;
+    std::ifstream file(path, std::ios::binary);
+    uint32_t header[2];
+    if (!file.read((char *)header, sizeof(header)))
+    {
+        return records;
+    }
+    if (header[0] != SEARCH_LOG_VERSION || header[1] != sizeof(Record))
+    {
+        std::cout << path << " was written by a different build" << std::endl;
+        return records;
+    }
+    // a crash can cut off the last record, and a record that was cut off is not read
+    Record record;
+    while (file.read((char *)&record, sizeof(Record)))
+    {
+        records.push_back(record);
+    }
+    return records;
+}
+
+bool SearchLog::replay(const std::string &path, int index, int repeats)
+{
+    std::vector<Record> records = load(path);
+    if (records.empty())
+    {
+        return false;
+    }
+    if (index < 0 || (size_t)index >= records.size())
+    {
+        std::cout << "the log only has " << records.size() << " records" << std::endl;
+        return false;
+    }
+    Record &target = records[index];
+    if (target.depth != SEARCH_DEPTH)
+    {
+        std::cout << "the search was " << target.depth << " plies deep, but this build searches "
+                  << SEARCH_DEPTH << " plies" << std::endl;
+        return false;
+    }
+
+    Board *board = new Board();
+    MoveGen *generator = new MoveGen(board);
+    Search *search = new Search(generator);
+    generator->pseudoLegal = target.flags & PSEUDO_LEGAL;
+    generator->flippedGeneration = target.flags & FLIPPED;
+    search->mateInOneDetection = target.flags & MATE_IN_ONE;
+    search->attackTables = target.flags & ATTACK_TABLES;
+    search->keepTable = target.flags & KEEP_TABLE;
+    // the log doesn't have the prior or the network in it, so these had better be the files the engine used
+    if (target.flags & PRIOR)
+    {
+        MovePrior *prior = new MovePrior();
+        if (prior->load(MOVE_PRIOR_FILE))
+        {
+            generator->prior = prior;
+        }
+        else
+        {
+            std::cout << "the search used " << MOVE_PRIOR_FILE << ", but it can't be read" << std::endl;
+        }
+    }
+    if (target.flags & NETWORK)
+    {
+        Network *network = new Network();
+        if (network->load(NETWORK_FILE))
+        {
+            search->evaluator.network = network;
+        }
+        else
+        {
+            std::cout << "the search used " << NETWORK_FILE << ", but it can't be read" << std::endl;
+        }
+    }
+    if (target.flags & SHARED_TABLE)
+    {
+        std::cout << "the search used a shared table. the other processes' entries are not in the log, "
+                  << "so the replay will not find the same table" << std::endl;
+    }
+
+    auto setUp = [&](Record &record)
+    {
+        board->position = record.position;
+        board->engineToMove = record.engineToMove;
+        board->update();
+    };
+
+    // the replay prints its own summary of each search, so the search doesn't print its root moves and stats
+    search->quiet = true;
+    if (search->keepTable)
+    {
+        // only the searches that finished are searched again. the ones that were stopped put less in the table
+        int warmed = 0;
+        for (int record = 0; record < index; record++)
+        {
+            if (records[record].searcher == target.searcher && records[record].flags & FINISHED)
+            {
+                setUp(records[record]);
+                search->getBestMove();
+                warmed++;
+            }
+        }
+        std::cout << "searched " << warmed << " earlier records of searcher " << target.searcher
+                  << " to fill the table" << std::endl;
+    }
+    // a search that doesn't keep its table hashed it right after clearing it, and our table is still new
+    bool sameTable = search->table.getHash() == target.tableHash;
+    std::cout << (sameTable ? "the table is the same as when the search started"
+                            : "the table is not the same as when the search started, so the search might not be either")
+              << std::endl;
+
+    // a search that was stopped has no move, and the replay searches it to the end
+    bool isFinished = target.flags & FINISHED;
+    std::cout << "recorded: " << target.microseconds / 1000 << "ms, " << target.nodes << " nodes, "
+              << (isFinished ? board->getMoveNotation(target.best) : "stopped before it finished") << std::endl;
+
+    // every repeat starts from the same table, so they all do the same work
+    TranspositionTable saved = search->table;
+    for (int repeat = 0; repeat < std::max(repeats, 1); repeat++)
+    {
+        search->table = saved;
+        setUp(target);
+        auto start = std::chrono::steady_clock::now();
+        Board::Move best = search->getBestMove();
+        auto end = std::chrono::steady_clock::now();
+
+        bool isSame = target.nodes == search->stats.nodes && target.best.from == best.from &&
+                      target.best.to == best.to && target.best.type == best.type;
+        std::cout << "replay " << repeat + 1 << ": "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms, "
+                  << search->stats.nodes << " nodes, " << board->getMoveNotation(best);
+        if (isFinished)
+        {
+            std::cout << (isSame ? ", the same search" : ", a different search");
+        }
+        std::cout << std::endl;
+    }
+    return true;
+}
@@ -0,0 +1,98 @@
+//
+// Created by Joe Chrisman on 6/12/22.
+//
+
+#ifndef UNTITLED2_SEARCHLOG_H
+#define UNTITLED2_SEARCHLOG_H
+
+#include <fstream>
+#include <mutex>
+#include "Board.h"
+
+/*
+ * when a search in a long running engine is much slower than it should be, we need that exact search again to
+ * look at it under a profiler. this writes down everything a search depends on, one record per search,
+ * and replay() runs a recorded search again.
+ *
+ * what a search does only depends on the position, SEARCH_DEPTH, the settings, the prior, the network and what was
+ * in the transposition table when it started. the board has no game history (the search doesn't look for repetitions)
+ * and the search has no randomness, so the position is all there is to know about the game.
+ * slicing the search doesn't change the tree it visits either, so the slices are not recorded.
+ *
+ * the table is the hard part. it is recorded as a hash of every entry, which is too little to rebuild it.
+ * but an engine that keeps its table only has in it what its own earlier searches put there.
+ * so every record says which searcher made it, and replay() searches the earlier records of that searcher first.
+ * the hashes tell us if that got the table right. they don't match when an earlier search was stopped part way,
+ * or when the table is shared with other processes
+ *
+ * a log is a header (the version and the size of a record) and then records one after another, as they are in memory.
+ * so a log can only be replayed by the same build that wrote it
+ */
+class SearchLog
+{
+public:
+    SearchLog();
+
+    // what changed how the search went, as bits of Record::flags
+    enum Flag : uint16_t
+    {
+        PSEUDO_LEGAL = 1,
+        FLIPPED = 2,
+        MATE_IN_ONE = 4,
+        ATTACK_TABLES = 8,
+        KEEP_TABLE = 16,
+        SHARED_TABLE = 32,
+        PRIOR = 64,
+        NETWORK = 128,
+        SLICED = 256, // time sliced. the tree is the same, only the time between the slices is not searching
+        FINISHED = 512 // not set if the search was stopped before it found a move
+    };
+
+    struct Record
+    {
+        uint32_t searcher;
+        uint32_t depth; // SEARCH_DEPTH of the build that searched
+        Board::Position position;
+        bool engineToMove;
+        uint16_t flags;
+        uint64_t tableHash; // TranspositionTable::getHash() right before the search started
+        // what happened, so a replay can tell if it did the same thing
+        uint64_t nodes;
+        uint64_t microseconds; // wall time from the start of the search to its end
+        Board::Move best;
+    };
+
+    // one search that records its searches. it fills in pending while it searches
+    struct Searcher
+    {
+        SearchLog *log;
+        uint32_t id;
+        Record pending;
+
+        // write the pending record to the log
+        void write();
+    };
+
+    // start a log at this path. returns false if it can't be written
+    bool open(const std::string &path);
+    // give a search its own searcher. every search that shares a table with another should have its own one
+    Searcher *addSearcher();
+
+    /*
+     * search a record again, after searching the records of the same searcher before it to warm up the table.
+     * the search is done repeats times, from the same table every time, so there is enough of it for a profiler.
+     * prints if the replay matched the record, and how long each search took. returns false if the log can't be read
+     */
+    static bool replay(const std::string &path, int index, int repeats);
+
+private:
+    std::ofstream file;
+    // the searchers can be on different threads
+    std::mutex mutex;
+    uint32_t searchers;
+
+    static std::vector<Record> load(const std::string &path);
+};
+
+
+#endif //UNTITLED2_SEARCHLOG_H
@@ -0,0 +1,256 @@
+//
+// Created by Joe Chrisman on 6/2/22.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <thread>
+#include "Trainer.h"
+
+Trainer::Trainer(int threads)
+{
+    this->threads = std::max(threads, 1);
+
+    weights.resize(WEIGHT_COUNT);
+    rounded.resize(WEIGHT_COUNT);
+    momentum.assign(WEIGHT_COUNT, 0);
+    velocity.assign(WEIGHT_COUNT, 0);
+    gradients.assign(this->threads, std::vector<float>(WEIGHT_COUNT));
+    steps = 0;
+
+    // start with small random weights and no biases
+    std::mt19937 random(0);
+    std::uniform_real_distribution<float> distribution(-0.1f, 0.1f);
+    for (int index = 0; index < WEIGHT_COUNT; index++)
+    {
+        bool isBias = (index >= HIDDEN_BIASES && index < OUTPUT_WEIGHTS) || index == OUTPUT_BIAS;
+        weights[index] = isBias ? 0 : distribution(random);
+    }
+}
+
+void Trainer::writeSample(std::ostream &file, Board::Position &position, int16_t score)
+{
+    file.write((const char *)position.pieces, 12 * 8);
+    file.write((const char *)&score, 2);
+}
+
+bool Trainer::readSample(std::istream &file, Sample &sample)
+{
+    file.read((char *)sample.pieces, 12 * 8);
+    file.read((char *)&sample.score, 2);
+    return (bool)file;
+}
+
+bool Trainer::train(const std::string &datasetPath, int epochs)
+{
+    std::vector<Sample> chunk(TRAINING_CHUNK_SIZE);
+    std::mt19937 random(0);
+
+    for (int epoch = 1; epoch <= epochs; epoch++)
+    {
+        std::ifstream file(datasetPath, std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        double loss = 0;
+        uint64_t positions = 0;
+        while (true)
+        {
+            int count = 0;
+            while (count < TRAINING_CHUNK_SIZE && readSample(file, chunk[count]))
+            {
+                count++;
+            }
+            if (!count)
+            {
+                break;
+            }
+            // positions next to each other in the file usually come from the same game, so mix them up
+            std::shuffle(chunk.begin(), chunk.begin() + count, random);
+
+            for (int batch = 0; batch < count; batch += TRAINING_BATCH_SIZE)
+            {
+                loss += trainBatch(&chunk[batch], std::min(TRAINING_BATCH_SIZE, count - batch));
+            }
+            positions += count;
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        std::cout << "epoch " << epoch << ": loss " << loss / std::max(positions, (uint64_t)1) << ", "
+                  << (uint64_t)(positions / std::max(seconds, 0.001)) << " positions/s" << std::endl;
+    }
+    return true;
+}
+
+bool Trainer::save(const std::string &path)
+{
+    roundWeights();
+    Network *network = new Network();
+    for (int input = 0; input < NETWORK_INPUTS; input++)
+    {
+        for (int neuron = 0; neuron < NETWORK_HIDDEN; neuron++)
+        {
+            int index = HIDDEN_WEIGHTS + input * NETWORK_HIDDEN + neuron;
+            network->hiddenWeights[input][neuron] = (int16_t)std::lround(rounded[index] * getScale(index));
+        }
+    }
+    for (int neuron = 0; neuron < NETWORK_HIDDEN; neuron++)
+    {
+        network->hiddenBiases[neuron] = (int16_t)std::lround(rounded[HIDDEN_BIASES + neuron] * getScale(HIDDEN_BIASES));
+        network->outputWeights[neuron] = (int16_t)std::lround(rounded[OUTPUT_WEIGHTS + neuron] * getScale(OUTPUT_WEIGHTS));
+    }
+    network->outputBias = (int32_t)std::lround(rounded[OUTPUT_BIAS] * getScale(OUTPUT_BIAS));
+
+    bool saved = network->save(path);
+    delete network;
+    return saved;
+}
+
+void Trainer::roundWeights()
+{
+    for (int index = 0; index < WEIGHT_COUNT; index++)
+    {
+        float scale = getScale(index);
+        rounded[index] = std::round(weights[index] * scale) / scale;
+    }
+}
+
+double Trainer::trainBatch(const Sample *samples, int count)
+{
+    roundWeights();
+
+    // give each thread an equal slice of the batch
+    std::vector<double> losses(threads, 0);
+    std::vector<std::thread> workers;
+    int slice = (count + threads - 1) / threads;
+    for (int thread = 0; thread < threads; thread++)
+    {
+        workers.emplace_back([&, thread]()
+        {
+            float *gradient = gradients[thread].data();
+            std::fill(gradient, gradient + WEIGHT_COUNT, 0.0f);
+            int end = std::min(count, (thread + 1) * slice);
+            for (int sample = thread * slice; sample < end; sample++)
+            {
+                losses[thread] += backpropagate(samples[sample], gradient);
+            }
+        });
+    }
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+
+    // adam. the running averages start at 0, so they are scaled up a lot for the first few steps
+    const float beta1 = 0.9f;
+    const float beta2 = 0.999f;
+    steps++;
+    float correction1 = 1 - std::pow(beta1, steps);
+    float correction2 = 1 - std::pow(beta2, steps);
+    for (int index = 0; index < WEIGHT_COUNT; index++)
+    {
+        float gradient = 0;
+        for (int thread = 0; thread < threads; thread++)
+        {
+            gradient += gradients[thread][index];
+        }
+        gradient /= count;
+
+        momentum[index] = beta1 * momentum[index] + (1 - beta1) * gradient;
+        velocity[index] = beta2 * velocity[index] + (1 - beta2) * gradient * gradient;
+        weights[index] -= TRAINING_LEARNING_RATE * (momentum[index] / correction1) /
+                          (std::sqrt(velocity[index] / correction2) + 1e-8f);
+
+        // keep every weight small enough to fit in an int16 once it is scaled
+        float limit = 32767 / getScale(index);
+        weights[index] = std::min(std::max(weights[index], -limit), limit);
+    }
+
+    double loss = 0;
+    for (double threadLoss : losses)
+    {
+        loss += threadLoss;
+    }
+    return loss;
+}
+
+float Trainer::backpropagate(const Sample &sample, float *gradient)
+{
+    // the inputs that are turned on. there is one for every piece on the board
+    int inputs[64];
+    int inputCount = 0;
+    for (int pieceType = PLAYER_PAWN; pieceType < NONE; pieceType++)
+    {
+        uint64_t pieces = sample.pieces[pieceType];
+        while (pieces && inputCount < 64)
+        {
+            inputs[inputCount++] = Network::getInput(pieceType, popLeastSquare(pieces));
+        }
+    }
+
+    /*
+     * the forward pass. the hidden layer is the biases plus the weights of the inputs that are on.
+     * the loops over the neurons work on whole rows of weights that sit next to each other in memory,
+     * so the compiler can turn them into vector instructions
+     */
+    float hidden[NETWORK_HIDDEN];
+    const float *hiddenBiases = &rounded[HIDDEN_BIASES];
+    for (int neuron = 0; neuron < NETWORK_HIDDEN; neuron++)
+    {
+        hidden[neuron] = hiddenBiases[neuron];
+    }
+    for (int input = 0; input < inputCount; input++)
+    {
+        const float *row = &rounded[HIDDEN_WEIGHTS + inputs[input] * NETWORK_HIDDEN];
+        for (int neuron = 0; neuron < NETWORK_HIDDEN; neuron++)
+        {
+            hidden[neuron] += row[neuron];
+        }
+    }
+
+    const float *outputWeights = &rounded[OUTPUT_WEIGHTS];
+    float activations[NETWORK_HIDDEN];
+    float output = rounded[OUTPUT_BIAS];
+    for (int neuron = 0; neuron < NETWORK_HIDDEN; neuron++)
+    {
+        activations[neuron] = std::min(std::max(hidden[neuron], 0.0f), 1.0f);
+        output += activations[neuron] * outputWeights[neuron];
+    }
+
+    // compare the win chances of our score and the dataset's score, instead of the scores themselves.
+    // this way a big mistake in a position that is already won doesn't count for much
+    float predicted = 1 / (1 + std::exp(-output));
+    float target = 1 / (1 + std::exp(-(float)sample.score / NETWORK_EVAL_SCALE));
+    float error = predicted - target;
+
+    // the backward pass
+    float outputGradient = 2 * error * predicted * (1 - predicted);
+    gradient[OUTPUT_BIAS] += outputGradient;
+
+    float hiddenGradient[NETWORK_HIDDEN];
+    for (int neuron = 0; neuron < NETWORK_HIDDEN; neuron++)
+    {
+        gradient[OUTPUT_WEIGHTS + neuron] += outputGradient * activations[neuron];
+        // a clipped neuron doesn't change the output when it changes a little
+        bool isClipped = hidden[neuron] <= 0 || hidden[neuron] >= 1;
+        hiddenGradient[neuron] = isClipped ? 0 : outputGradient * outputWeights[neuron];
+        gradient[HIDDEN_BIASES + neuron] += hiddenGradient[neuron];
+    }
+    // only the rows of the inputs that are on get a gradient
+    for (int input = 0; input < inputCount; input++)
+    {
+        float *row = &gradient[HIDDEN_WEIGHTS + inputs[input] * NETWORK_HIDDEN];
+        for (int neuron = 0; neuron < NETWORK_HIDDEN; neuron++)
+        {
+            row[neuron] += hiddenGradient[neuron];
+        }
+    }
+    return error * error;
+}
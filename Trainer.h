@@ -0,0 +1,92 @@
+//
+// Created by Joe Chrisman on 6/2/22.
+//
+
+#ifndef UNTITLED2_TRAINER_H
+#define UNTITLED2_TRAINER_H
+
+#include "Network.h"
+
+/*
+ * learns the weights of the evaluation network from a dataset of scored positions, on the cpu.
+ *
+ * the dataset is read a chunk at a time, so it can be much bigger than memory. every batch is split between
+ * the threads, and each thread works out how the weights should change for its part of the batch.
+ * then the changes are added up and the weights are moved with the adam optimizer.
+ *
+ * the network only ever sees integer weights when it plays, so while training we round the weights
+ * the same way before using them. this way the network learns to work with the rounding instead of being surprised by it.
+ * the rounding is ignored when working out how the weights should change
+ */
+class Trainer
+{
+public:
+    Trainer(int threads);
+
+    /*
+     * one position of the dataset. the file is these one after another, SAMPLE_BYTES each, little endian:
+     * the 12 piece bitboards in PieceType order, then the score in centipawns (positive if the engine is winning)
+     */
+    struct Sample
+    {
+        uint64_t pieces[12];
+        int16_t score;
+    };
+    static const int SAMPLE_BYTES = 12 * 8 + 2;
+
+    static void writeSample(std::ostream &file, Board::Position &position, int16_t score);
+    static bool readSample(std::istream &file, Sample &sample);
+
+    // go through the dataset the given number of times, and print the average loss after each time
+    bool train(const std::string &datasetPath, int epochs);
+
+    // round the weights to integers and save them so the Network can load them
+    bool save(const std::string &path);
+
+private:
+    int threads;
+
+    // where each kind of weight starts in the weight vectors below. they are in the same order as in Network
+    static const int HIDDEN_WEIGHTS = 0;
+    static const int HIDDEN_BIASES = HIDDEN_WEIGHTS + NETWORK_INPUTS * NETWORK_HIDDEN;
+    static const int OUTPUT_WEIGHTS = HIDDEN_BIASES + NETWORK_HIDDEN;
+    static const int OUTPUT_BIAS = OUTPUT_WEIGHTS + NETWORK_HIDDEN;
+    static const int WEIGHT_COUNT = OUTPUT_BIAS + 1;
+
+    std::vector<float> weights;
+    // the weights rounded to what the Network can store. this is what the forward pass uses
+    std::vector<float> rounded;
+
+    // the adam optimizer's running averages of the gradients and the squared gradients
+    std::vector<float> momentum;
+    std::vector<float> velocity;
+    int steps;
+
+    // one gradient vector per thread, so the threads never write to the same memory
+    std::vector<std::vector<float>> gradients;
+
+    // how much each kind of weight is multiplied by when it is stored as an integer
+    static inline float getScale(int index)
+    {
+        if (index < OUTPUT_WEIGHTS)
+        {
+            return NETWORK_HIDDEN_SCALE;
+        }
+        if (index < OUTPUT_BIAS)
+        {
+            return NETWORK_OUTPUT_SCALE;
+        }
+        return NETWORK_HIDDEN_SCALE * NETWORK_OUTPUT_SCALE;
+    }
+
+    void roundWeights();
+
+    // train on a batch of samples. returns the total loss of the batch
+    double trainBatch(const Sample *samples, int count);
+
+    // run one sample forwards and backwards, and add its gradient to the given gradient vector. returns the loss
+    float backpropagate(const Sample &sample, float *gradient);
+};
+
+
+#endif //UNTITLED2_TRAINER_H
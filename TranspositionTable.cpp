@@ -0,0 +1,384 @@
+//
+// Created by Joe Chrisman on 6/4/22.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <random>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "TranspositionTable.h"
+
+TranspositionTable::TranspositionTable()
+{
+    // always use the same keys, so the same position gets the same key every time the program runs
+    std::mt19937_64 random(0x5eed);
+    for (int pieceType = PLAYER_PAWN; pieceType < NONE; pieceType++)
+    {
+        for (int square = 0; square < 64; square++)
+        {
+            pieceKeys[pieceType][square] = random();
+        }
+    }
+    for (uint64_t &key : castleKeys)
+    {
+        key = random();
+    }
+    for (uint64_t &key : enPassantKeys)
+    {
+        key = random();
+    }
+    engineToMoveKey = random();
+
+    sharedHeader = nullptr;
+    sharedTable = nullptr;
+    frontTable.resize(TT_FRONT_ENTRIES);
+    mainTable.resize(TT_MAIN_ENTRIES);
+    clear();
+}
+
+uint64_t TranspositionTable::getKey(Board::Position &position, bool engineToMove)
+{
+    uint64_t key = 0;
+    for (int pieceType = PLAYER_PAWN; pieceType < NONE; pieceType++)
+    {
+        uint64_t pieces = position.pieces[pieceType];
+        while (pieces)
+        {
+            key ^= pieceKeys[pieceType][popLeastSquare(pieces)];
+        }
+    }
+
+    if (position.playerCastleQueenside)
+    {
+        key ^= castleKeys[0];
+    }
+    if (position.playerCastleKingside)
+    {
+        key ^= castleKeys[1];
+    }
+    if (position.engineCastleQueenside)
+    {
+        key ^= castleKeys[2];
+    }
+    if (position.engineCastleKingside)
+    {
+        key ^= castleKeys[3];
+    }
+    if (position.enPassantCapture)
+    {
+        key ^= enPassantKeys[getLeastSquare(position.enPassantCapture)];
+    }
+    if (engineToMove)
+    {
+        key ^= engineToMoveKey;
+    }
+    return key;
+}
+
+TranspositionTable::Entry *TranspositionTable::probe(uint64_t key, int depth)
+{
+    bool isFront = depth <= TT_FRONT_DEPTH;
+    if (!isFront && sharedTable)
+    {
+        return probeShared(key, depth);
+    }
+    TierStats &stats = isFront ? frontStats : mainStats;
+    Entry &entry = isFront ? frontTable[key & (TT_FRONT_ENTRIES - 1)] : mainTable[key & (TT_MAIN_ENTRIES - 1)];
+
+    stats.probes++;
+    if (entry.key != key || entry.depth < depth)
+    {
+        return nullptr;
+    }
+    stats.hits++;
+    return &entry;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, int ply, int score, Bound bound, Board::Move &best)
+{
+    bool isFront = depth <= TT_FRONT_DEPTH;
+    Entry &entry = isFront ? frontTable[key & (TT_FRONT_ENTRIES - 1)] : mainTable[key & (TT_MAIN_ENTRIES - 1)];
+
+    // the front table is small and its entries are cheap to make again, so new entries always win there.
+    // in the main table, keep the entry that took the most work to make
+    if (!isFront && !sharedTable && entry.key && entry.depth > depth)
+    {
+        return;
+    }
+
+    // store checkmates as the distance from this node
+    if (score > MAX_EVAL - MATE_THRESHOLD)
+    {
+        score += ply;
+    }
+    else if (score < MIN_EVAL + MATE_THRESHOLD)
+    {
+        score -= ply;
+    }
+    if (!isFront && sharedTable)
+    {
+        storeShared(key, depth, score, bound, best);
+        return;
+    }
+    if (!entry.key)
+    {
+        (isFront ? frontStats : mainStats).filled++;
+    }
+    entry = Entry{key, score, (uint8_t)depth, bound, best.from, best.to};
+}
+
+int TranspositionTable::getScore(Entry *entry, int ply)
+{
+    if (entry->score > MAX_EVAL - MATE_THRESHOLD)
+    {
+        return entry->score - ply;
+    }
+    if (entry->score < MIN_EVAL + MATE_THRESHOLD)
+    {
+        return entry->score + ply;
+    }
+    return entry->score;
+}
+
+void TranspositionTable::clear()
+{
+    std::fill(frontTable.begin(), frontTable.end(), Entry{});
+    std::fill(mainTable.begin(), mainTable.end(), Entry{});
+    if (sharedHeader)
+    {
+        sharedHeader->generation.fetch_add(1, std::memory_order_relaxed);
+    }
+    frontStats = TierStats{0, 0, 0};
+    mainStats = TierStats{0, 0, 0};
+}
+
+void TranspositionTable::clearStats()
+{
+    frontStats.probes = 0;
+    frontStats.hits = 0;
+    mainStats.probes = 0;
+    mainStats.hits = 0;
+}
+
+uint64_t TranspositionTable::getHash()
+{
+    // every entry goes in at its own place, so the same entries in different slots don't hash the same
+    uint64_t hash = 0;
+    auto add = [&](uint64_t first, uint64_t second)
+    {
+        hash = (hash ^ first) * 0x100000001B3ull;
+        hash = (hash ^ second) * 0x100000001B3ull;
+    };
+    for (Entry &entry : frontTable)
+    {
+        add(entry.key, (uint32_t)entry.score | (uint64_t)entry.depth << 32 | (uint64_t)entry.bound << 40 |
+                       (uint64_t)entry.from << 48 | (uint64_t)entry.to << 56);
+    }
+    if (sharedTable)
+    {
+        for (int index = 0; index < TT_MAIN_ENTRIES; index++)
+        {
+            add(sharedTable[index].check.load(std::memory_order_relaxed),
+                sharedTable[index].data.load(std::memory_order_relaxed));
+        }
+        return hash;
+    }
+    for (Entry &entry : mainTable)
+    {
+        add(entry.key, (uint32_t)entry.score | (uint64_t)entry.depth << 32 | (uint64_t)entry.bound << 40 |
+                       (uint64_t)entry.from << 48 | (uint64_t)entry.to << 56);
+    }
+    return hash;
+}
+
+bool TranspositionTable::isShared()
+{
+    return sharedTable;
+}
+
+bool TranspositionTable::share(const std::string &name, Network *network)
+{
+    static_assert(sizeof(SharedEntry) == 16, "a shared entry should be two words");
+    // shm_open wants the name to start with a slash
+    std::string path = name[0] == '/' ? name : "/" + name;
+    size_t size = sizeof(SharedHeader) + sizeof(SharedEntry) * TT_MAIN_ENTRIES;
+
+    // whoever makes the segment sets up its header. everybody else only checks it
+    bool isMaker = true;
+    int file = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (file < 0 && errno == EEXIST)
+    {
+        isMaker = false;
+        file = shm_open(path.c_str(), O_RDWR, 0600);
+    }
+    if (file < 0)
+    {
+        std::cout << "could not open the shared table " << path << std::endl;
+        return false;
+    }
+    // a new segment is all zeros, which is an empty entry
+    if (isMaker && ftruncate(file, (off_t)size) < 0)
+    {
+        std::cout << "could not make the shared table " << path << " big enough" << std::endl;
+        close(file);
+        shm_unlink(path.c_str());
+        return false;
+    }
+
+    // the process that made the segment might not have given it its size yet
+    auto start = std::chrono::steady_clock::now();
+    auto isWaitOver = [&]()
+    {
+        auto waited = std::chrono::steady_clock::now() - start;
+        if (waited > std::chrono::milliseconds(SHARED_TABLE_WAIT_MS))
+        {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return false;
+    };
+    struct stat info{};
+    while (!isMaker && fstat(file, &info) == 0 && info.st_size == 0 && !isWaitOver())
+    {
+    }
+    if (!isMaker && (size_t)info.st_size != size)
+    {
+        std::cout << "the shared table " << path << (info.st_size ? " was made by a build with a different table layout"
+                                                                   : " was never finished by the process that made it")
+                  << ". remove /dev/shm" << path << " when no engine is using it" << std::endl;
+        close(file);
+        return false;
+    }
+
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+    if (memory == MAP_FAILED)
+    {
+        std::cout << "could not map the shared table " << path << std::endl;
+        return false;
+    }
+    auto *header = (SharedHeader *)memory;
+
+    if (isMaker)
+    {
+        header->version = SHARED_TABLE_VERSION;
+        header->entrySize = sizeof(SharedEntry);
+        header->entries = TT_MAIN_ENTRIES;
+        header->keysChecksum = getKeysChecksum();
+        header->evaluator = network ? network->getHash() : 0;
+        header->engineIsWhite = ENGINE_IS_WHITE;
+        header->generation.store(0, std::memory_order_relaxed);
+        // the other processes can read the header once they see this
+        header->ready.store(1, std::memory_order_release);
+    }
+    else
+    {
+        while (!header->ready.load(std::memory_order_acquire) && !isWaitOver())
+        {
+        }
+        // a process that died while making the segment leaves it without a header forever
+        bool isReady = header->ready.load(std::memory_order_acquire);
+        if (!isReady || header->version != SHARED_TABLE_VERSION || header->entrySize != sizeof(SharedEntry) ||
+            header->entries != TT_MAIN_ENTRIES || header->keysChecksum != getKeysChecksum())
+        {
+            std::cout << "the shared table " << path << (isReady ? " was made by a build with a different table layout"
+                                                                  : " was never finished by the process that made it")
+                      << ". remove /dev/shm" << path << " when no engine is using it" << std::endl;
+            munmap(memory, size);
+            return false;
+        }
+        if (header->evaluator != (network ? network->getHash() : 0) || header->engineIsWhite != ENGINE_IS_WHITE)
+        {
+            std::cout << "the shared table " << path << " belongs to engines that score positions differently. "
+                      << "share a table only between engines with the same network and the same color" << std::endl;
+            munmap(memory, size);
+            return false;
+        }
+    }
+
+    sharedHeader = header;
+    sharedTable = (SharedEntry *)(header + 1);
+    // our own main table is not used anymore
+    mainTable.clear();
+    mainTable.shrink_to_fit();
+    mainStats = TierStats{0, 0, 0};
+    return true;
+}
+
+TranspositionTable::Entry *TranspositionTable::probeShared(uint64_t key, int depth)
+{
+    SharedEntry &entry = sharedTable[key & (TT_MAIN_ENTRIES - 1)];
+    mainStats.probes++;
+    uint64_t check = entry.check.load(std::memory_order_relaxed);
+    uint64_t data = entry.data.load(std::memory_order_relaxed);
+    // a different position, an empty entry, or the two halves of two different writes
+    if ((check ^ data) != key || (int)(data >> 32 & 0xff) < depth)
+    {
+        return nullptr;
+    }
+    mainStats.hits++;
+    found = Entry{
+            key,
+            (int32_t)(uint32_t)data,
+            (uint8_t)(data >> 32),
+            (uint8_t)(data >> 40 & 0x3),
+            (uint8_t)(data >> 48),
+            (uint8_t)(data >> 56)
+    };
+    return &found;
+}
+
+void TranspositionTable::storeShared(uint64_t key, int depth, int score, Bound bound, Board::Move &best)
+{
+    SharedEntry &entry = sharedTable[key & (TT_MAIN_ENTRIES - 1)];
+    uint32_t generation = sharedHeader->generation.load(std::memory_order_relaxed) & 0x3f;
+    uint64_t check = entry.check.load(std::memory_order_relaxed);
+    uint64_t data = entry.data.load(std::memory_order_relaxed);
+
+    // like our own main table, keep the entry that took the most work to make.
+    // but an entry from an older generation is from a search that is over, so it always loses
+    bool isEmpty = !check && !data;
+    if (!isEmpty && (data >> 42 & 0x3f) == generation && (int)(data >> 32 & 0xff) > depth)
+    {
+        return;
+    }
+    if (isEmpty)
+    {
+        mainStats.filled++;
+    }
+
+    // the score, the depth, the bound and the generation in 2 bits and 6 bits, then the move
+    data = (uint64_t)(uint32_t)score | (uint64_t)depth << 32 | (uint64_t)bound << 40 | (uint64_t)generation << 42 |
+           (uint64_t)best.from << 48 | (uint64_t)best.to << 56;
+    entry.check.store(key ^ data, std::memory_order_relaxed);
+    entry.data.store(data, std::memory_order_relaxed);
+}
+
+uint64_t TranspositionTable::getKeysChecksum()
+{
+    uint64_t checksum = engineToMoveKey;
+    auto add = [&](uint64_t key)
+    {
+        checksum = (checksum << 7 | checksum >> 57) ^ key;
+    };
+    for (auto &keys : pieceKeys)
+    {
+        for (uint64_t key : keys)
+        {
+            add(key);
+        }
+    }
+    for (uint64_t key : castleKeys)
+    {
+        add(key);
+    }
+    for (uint64_t key : enPassantKeys)
+    {
+        add(key);
+    }
+    return checksum;
+}
@@ -0,0 +1,128 @@
+//
+// Created by Joe Chrisman on 6/4/22.
+//
+
+#ifndef UNTITLED2_TRANSPOSITIONTABLE_H
+#define UNTITLED2_TRANSPOSITIONTABLE_H
+
+#include <atomic>
+#include "Network.h"
+
+/*
+ * the same position can be reached by playing the same moves in a different order.
+ * this table remembers what the search found out about each position, so it doesn't have to search it twice.
+ *
+ * positions are looked up by their zobrist key. that is a random number for every piece on every square
+ * (and for the castling rights, the en passant square and the side to move) all xored together.
+ *
+ * the main table can be shared with other engine processes through a named shared memory segment (see share()).
+ * there are no locks on it. every shared entry is two words, and the first word is the key xored with the second,
+ * so an entry that another process was in the middle of writing just looks like a different position
+ */
+class TranspositionTable
+{
+public:
+    TranspositionTable();
+
+    // what a stored score means. the search might have stopped early, so the score is not always exact
+    enum Bound : uint8_t
+    {
+        EXACT,
+        LOWER_BOUND, // the node failed high. the real score is at least this high
+        UPPER_BOUND // the node failed low. the real score is at most this high
+    };
+
+    struct Entry
+    {
+        uint64_t key;
+        int32_t score;
+        uint8_t depth; // how many plies were left to search
+        uint8_t bound;
+        // the best move we found. from and to are the same if there was none
+        uint8_t from;
+        uint8_t to;
+    };
+
+    // how often each table was looked at, how often it had the position we wanted, and how many entries are in use
+    struct TierStats
+    {
+        uint64_t probes;
+        uint64_t hits;
+        uint64_t filled;
+    };
+    TierStats frontStats;
+    TierStats mainStats;
+
+    uint64_t getKey(Board::Position &position, bool engineToMove);
+
+    // find an entry for the position that was searched at least as deep as we want. returns nullptr if there is none
+    Entry *probe(uint64_t key, int depth);
+    void store(uint64_t key, int depth, int ply, int score, Bound bound, Board::Move &best);
+
+    /*
+     * checkmate scores depend on how far from the root the mate is.
+     * so they are stored as the distance from the node instead, and turned back into a distance from the root here
+     */
+    static int getScore(Entry *entry, int ply);
+
+    /*
+     * keep the main table in the shared memory segment with this name, and make it if nobody has yet.
+     * network is what scores our positions, or null for the hand written evaluation.
+     * returns false if the segment can't be opened, or it was made by a build with a different table layout
+     * or different zobrist keys, or by an engine whose scores mean something else: a different network,
+     * or the engine playing the other color. the front table always stays in this process
+     */
+    bool share(const std::string &name, Network *network);
+
+    /*
+     * forget everything, and reset the stats.
+     * a shared main table is not wiped, because the other processes are still using it. its generation goes up instead,
+     * so the entries from before are the first to be replaced
+     */
+    void clear();
+    // reset the probes and the hits, but keep the entries
+    void clearStats();
+
+    // a hash of every entry in both tables, to tell if two tables know the same things. it reads the whole table
+    uint64_t getHash();
+    bool isShared();
+
+private:
+    std::vector<Entry> frontTable;
+    std::vector<Entry> mainTable;
+
+    // the start of the shared segment. everything in it has to stay the same size in every build with the same version
+    struct SharedHeader
+    {
+        uint32_t version;
+        uint32_t entrySize;
+        uint64_t entries;
+        uint64_t keysChecksum; // so two builds with different zobrist keys don't trust each other's entries
+        // so engines that score positions differently don't trust each other's scores. 0 is the hand written evaluation
+        uint64_t evaluator;
+        uint32_t engineIsWhite;
+        std::atomic<uint32_t> ready; // set last by the process that made the segment
+        std::atomic<uint32_t> generation; // goes up every time somebody clears the table
+    };
+    struct SharedEntry
+    {
+        std::atomic<uint64_t> check; // the key xored with data
+        std::atomic<uint64_t> data; // the rest of the entry, and the generation it was stored in
+    };
+    SharedHeader *sharedHeader;
+    SharedEntry *sharedTable;
+    // a copy of the last shared entry we found. the one in shared memory can change under us at any time
+    Entry found;
+
+    Entry *probeShared(uint64_t key, int depth);
+    void storeShared(uint64_t key, int depth, int score, Bound bound, Board::Move &best);
+    uint64_t getKeysChecksum();
+
+    uint64_t pieceKeys[12][64];
+    uint64_t castleKeys[4];
+    uint64_t enPassantKeys[64];
+    uint64_t engineToMoveKey;
+};
+
+
+#endif //UNTITLED2_TRANSPOSITIONTABLE_H
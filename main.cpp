@@ -2,19 +2,47 @@
 // Created by Joe Chrisman on 2/23/22.
 //
 
+#include <thread>
+#include <unordered_set>
 #include "ChessGame.h"
+#include "DistributedPerft.h"
+#include "GameArchive.h"
+#include "LatencyBench.h"
+#include "Playout.h"
+#include "QuietFilter.h"
+#include "Scheduler.h"
+#include "Trainer.h"
 #include "iostream"
 
 SDL_Window *window;
 SDL_Renderer *renderer;
 ChessGame *game;
 
+// made when "--metrics <port>" comes before the other arguments. the modes that search add their workers to it
+Metrics *metrics = nullptr;
+int metricsPort;
+
+// made when "--shared-table <name>" comes before the other arguments. the searches keep their main table in it
+std::string sharedTable;
+
+// made when "--capture <path>" comes before the other arguments. the modes that search record every search in it
+SearchLog *searchLog = nullptr;
+
+// start serving the metrics once every worker was added
+void serveMetrics()
+{
+    if (metrics && !metrics->serve(metricsPort))
+    {
+        std::cout << "could not serve metrics on port " << metricsPort << std::endl;
+    }
+}
+
 void start()
 {
     srand(time(nullptr));
     SDL_Init(SDL_INIT_EVERYTHING);
     SDL_CreateWindowAndRenderer(WINDOW_SIZE, WINDOW_SIZE, 0, &window, &renderer);
-    game = new ChessGame(renderer);
+    game = new ChessGame(renderer, sharedTable, searchLog);
 }
 
 void run()
@@ -32,6 +60,8 @@ void run()
             // don't rerender the frame if nothing changed
             bool shouldRenderFrame = game->isAnimating();
             game->updateMovingPiece();
+            // if the engine is thinking, let it think for part of this frame
+            game->updateSearch();
 
             SDL_Event event;
             while (SDL_PollEvent(&event))
@@ -75,8 +105,359 @@ void stop()
     SDL_Quit();
 }
 
-int main()
+/*
+ * learn the quiet move ordering table from game archives, without opening a window.
+ * usage: --learn-prior <archive>... <output>
+ */
+int learnPrior(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        std::cout << "usage: --learn-prior <archive>... <output>" << std::endl;
+        return 1;
+    }
+    Board *board = new Board();
+    MoveGen *generator = new MoveGen(board);
+    GameArchive archive(generator);
+
+    std::vector<std::vector<Board::Move>> games;
+    for (int arg = 2; arg < argc - 1; arg++)
+    {
+        std::vector<std::vector<Board::Move>> loaded = archive.load(argv[arg]);
+        games.insert(games.end(), loaded.begin(), loaded.end());
+    }
+    std::cout << "learning from " << games.size() << " games" << std::endl;
+
+    MovePrior *prior = new MovePrior();
+    prior->learn(generator, games);
+    if (!prior->save(argv[argc - 1]))
+    {
+        std::cout << "could not write " << argv[argc - 1] << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * find the fastest settings for this machine and save them to ENGINE_CONFIG_FILE, without opening a window.
+ * usage: --autotune
+ */
+int autotune()
+{
+    Board *board = new Board();
+    MoveGen *generator = new MoveGen(board);
+    Search *search = new Search(generator);
+
+    EngineConfig config;
+    config.autotune(search);
+    if (!config.save(ENGINE_CONFIG_FILE))
+    {
+        std::cout << "could not write " << ENGINE_CONFIG_FILE << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * train the evaluation network on a dataset of scored positions, without opening a window.
+ * usage: --train <dataset> <output> [epochs] [threads]
+ */
+int train(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        std::cout << "usage: --train <dataset> <output> [epochs] [threads]" << std::endl;
+        return 1;
+    }
+    int epochs = argc > 4 ? atoi(argv[4]) : 10;
+    int threads = argc > 5 ? atoi(argv[5]) : (int)std::thread::hardware_concurrency();
+
+    Trainer *trainer = new Trainer(threads);
+    if (!trainer->train(argv[2], epochs))
+    {
+        std::cout << "could not read " << argv[2] << std::endl;
+        return 1;
+    }
+    if (!trainer->save(argv[3]))
+    {
+        std::cout << "could not write " << argv[3] << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * keep only the quiet positions of a FEN/EPD file or a dataset, and write them as a dataset, without opening a window.
+ * usage: --filter-quiet <input> <output> [threads]
+ */
+int filterQuiet(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        std::cout << "usage: --filter-quiet <input> <output> [threads]" << std::endl;
+        return 1;
+    }
+    int threads = argc > 4 ? atoi(argv[4]) : (int)std::thread::hardware_concurrency();
+
+    QuietFilter *filter = new QuietFilter(threads, metrics);
+    serveMetrics();
+    if (!filter->filter(argv[2], argv[3]))
+    {
+        std::cout << "could not read " << argv[2] << " or write " << argv[3] << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * replay the games of an archive and measure how long the engine takes for each of its moves, without opening a window.
+ * the search is set up like the game sets it up. usage: --latency-bench <archive> [csv]
+ */
+int latencyBench(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "usage: --latency-bench <archive> [csv]" << std::endl;
+        return 1;
+    }
+    Board *board = new Board();
+    MoveGen *generator = new MoveGen(board);
+    Search *search = new Search(generator);
+    // the bench prints its own report, so the search doesn't need to print every root move
+    search->quiet = true;
+
+    EngineConfig config;
+    if (config.load(ENGINE_CONFIG_FILE))
+    {
+        config.apply(search);
+    }
+    MovePrior *prior = new MovePrior();
+    if (prior->load(MOVE_PRIOR_FILE))
+    {
+        generator->prior = prior;
+    }
+    Network *network = new Network();
+    if (network->load(NETWORK_FILE))
+    {
+        search->evaluator.network = network;
+    }
+
+    if (metrics)
+    {
+        search->metrics = metrics->addWorker();
+    }
+    serveMetrics();
+    if (!sharedTable.empty())
+    {
+        search->table.share(sharedTable, search->evaluator.network);
+    }
+    if (searchLog)
+    {
+        search->log = searchLog->addSearcher();
+    }
+
+    LatencyBench bench(search);
+    if (!bench.run(argv[2], argc > 3 ? argv[3] : ""))
+    {
+        std::cout << "could not read " << argv[2] << (argc > 3 ? std::string(" or write ") + argv[3] : "") << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * search a file of analysis jobs with deadlines and priorities, and report how many deadlines were missed,
+ * without opening a window. usage: --schedule <jobs>
+ */
+int schedule(int argc, char *argv[])
 {
+    if (argc < 3)
+    {
+        std::cout << "usage: --schedule <jobs>" << std::endl;
+        return 1;
+    }
+    EngineConfig config;
+    config.load(ENGINE_CONFIG_FILE);
+    MovePrior *prior = new MovePrior();
+    if (!prior->load(MOVE_PRIOR_FILE))
+    {
+        prior = nullptr;
+    }
+    Network *network = new Network();
+    if (!network->load(NETWORK_FILE))
+    {
+        network = nullptr;
+    }
+
+    Scheduler scheduler(config, prior, network, metrics, sharedTable, searchLog);
+    if (!scheduler.load(argv[2]))
+    {
+        std::cout << "could not read " << argv[2] << std::endl;
+        return 1;
+    }
+    serveMetrics();
+    scheduler.run();
+    return 0;
+}
+
+/*
+ * count the positions at a depth with local worker processes, and keep the finished parts in a checkpoint file,
+ * so a run that was stopped picks up where it was. the position is the start position unless a FEN is given.
+ * usage: --perft <depth> <split depth> <workers> <checkpoint> [fen]
+ */
+int distributedPerft(int argc, char *argv[])
+{
+    if (argc < 6)
+    {
+        std::cout << "usage: --perft <depth> <split depth> <workers> <checkpoint> [fen]" << std::endl;
+        return 1;
+    }
+    std::string fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -";
+    if (argc > 6)
+    {
+        // the fields of a FEN come in as separate arguments unless they were quoted
+        fen = argv[6];
+        for (int arg = 7; arg < argc; arg++)
+        {
+            fen += std::string(" ") + argv[arg];
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    DistributedPerft perft(fen, atoi(argv[2]), atoi(argv[3]));
+    uint64_t total;
+    if (!perft.run(atoi(argv[4]), argv[5], total))
+    {
+        std::cout << "the perft did not finish" << std::endl;
+        return 1;
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "perft " << argv[2] << ": " << total << " positions in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms" << std::endl;
+    return 0;
+}
+
+/*
+ * play random games from the start position as fast as we can, and print how many playouts per second
+ * one thread and all the threads played. usage: --playouts <seconds> [threads] [capture weight]
+ */
+int playouts(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "usage: --playouts <seconds> [threads] [capture weight]" << std::endl;
+        return 1;
+    }
+    int threads = argc > 3 ? atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+    int captureWeight = argc > 4 ? std::max(atoi(argv[4]), 1) : PLAYOUT_CAPTURE_WEIGHT;
+    Playout::benchmark(threads, atoi(argv[2]), captureWeight);
+    return 0;
+}
+
+/*
+ * search a search from a "--capture" log again, as many times as we like, so it can be run under a profiler.
+ * records are counted from 0. usage: --replay <log> <record> [repeats]
+ */
+int replay(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        std::cout << "usage: --replay <log> <record> [repeats]" << std::endl;
+        return 1;
+    }
+    if (!SearchLog::replay(argv[2], atoi(argv[3]), argc > 4 ? atoi(argv[4]) : 1))
+    {
+        std::cout << "could not replay record " << argv[3] << " of " << argv[2] << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    /*
+     * serve prometheus metrics on a local port while a search heavy mode runs.
+     * usage: --metrics <port> followed by --filter-quiet, --latency-bench or --schedule and their arguments
+     */
+    if (argc > 2 && std::string(argv[1]) == "--metrics")
+    {
+        metrics = new Metrics();
+        metricsPort = atoi(argv[2]);
+        // drop the two arguments, so the mode below sees its own arguments where it expects them
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+    /*
+     * keep the main transposition table in a named shared memory segment, so engine processes on this machine
+     * use each other's work. it works with the game, --latency-bench and --schedule.
+     * usage: --shared-table <name> followed by the usual arguments
+     */
+    if (argc > 2 && std::string(argv[1]) == "--shared-table")
+    {
+        sharedTable = argv[2];
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+    /*
+     * record every search the game, --latency-bench or --schedule does, so a slow one can be replayed with --replay.
+     * usage: --capture <path> followed by the usual arguments
+     */
+    if (argc > 2 && std::string(argv[1]) == "--capture")
+    {
+        searchLog = new SearchLog();
+        if (!searchLog->open(argv[2]))
+        {
+            std::cout << "could not write " << argv[2] << std::endl;
+            return 1;
+        }
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--learn-prior")
+    {
+        return learnPrior(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--autotune")
+    {
+        return autotune();
+    }
+    if (argc > 1 && std::string(argv[1]) == "--train")
+    {
+        return train(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--filter-quiet")
+    {
+        return filterQuiet(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--latency-bench")
+    {
+        return latencyBench(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--schedule")
+    {
+        return schedule(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--playouts")
+    {
+        return playouts(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--replay")
+    {
+        return replay(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--perft")
+    {
+        return distributedPerft(argc, argv);
+    }
+    // usage: --perft-worker <port>
+    if (argc > 2 && std::string(argv[1]) == "--perft-worker")
+    {
+        return DistributedPerft::work(atoi(argv[2])) ? 0 : 1;
+    }
+
     start();
     run();
     stop();